@@ -36,23 +36,19 @@
 
 void i2c_send_byte(unsigned char dta)
 {
-    Wire.beginTransmission(LCD_ADDRESS);        // transmit to device #4
-    Wire.write(dta);                            // sends five bytes
-    Wire.endTransmission();                     // stop transmitting
+    I2CQueue::transmit(LCD_ADDRESS, &dta, 1);   // transmit to device #4
 }
 
 void i2c_send_byteS(unsigned char *dta, unsigned char len)
 {
-    Wire.beginTransmission(LCD_ADDRESS);        // transmit to device #4
-    for(int i=0; i<len; i++)
-    {
-        Wire.write(dta[i]);
-    }
-    Wire.endTransmission();                     // stop transmitting
+    I2CQueue::transmit(LCD_ADDRESS, dta, len);  // transmit to device #4
 }
 
 rgb_lcd::rgb_lcd()
 {
+    _displayfunction = 0;
+    _async = false;
+    _droppedWrites = 0;
 }
 
 void rgb_lcd::begin(uint8_t cols, uint8_t lines, uint8_t dotsize) 
@@ -74,7 +70,7 @@ void rgb_lcd::begin(uint8_t cols, uint8_t lines, uint8_t dotsize)
     // SEE PAGE 45/46 FOR INITIALIZATION SPECIFICATION!
     // according to datasheet, we need at least 40ms after power rises above 2.7V
     // before sending commands. Arduino can turn on way befer 4.5V so we'll wait 50
-    delayMicroseconds(50000);
+    holdOff(50000);
 
 
     // this is according to the hitachi HD44780 datasheet
@@ -82,11 +78,11 @@ void rgb_lcd::begin(uint8_t cols, uint8_t lines, uint8_t dotsize)
 
     // Send function set command sequence
     command(LCD_FUNCTIONSET | _displayfunction);
-    delayMicroseconds(4500);  // wait more than 4.1ms
+    holdOff(4500);  // wait more than 4.1ms
 
     // second try
     command(LCD_FUNCTIONSET | _displayfunction);
-    delayMicroseconds(150);
+    holdOff(150);
 
     // third go
     command(LCD_FUNCTIONSET | _displayfunction);
@@ -121,22 +117,20 @@ void rgb_lcd::begin(uint8_t cols, uint8_t lines, uint8_t dotsize)
 void rgb_lcd::clear()
 {
     command(LCD_CLEARDISPLAY);        // clear display, set cursor position to zero
-    delayMicroseconds(2000);          // this command takes a long time!
+    holdOff(2000);                    // this command takes a long time!
 }
 
 void rgb_lcd::home()
 {
     command(LCD_RETURNHOME);        // set cursor position to zero
-    delayMicroseconds(2000);        // this command takes a long time!
+    holdOff(2000);                  // this command takes a long time!
 }
 
 void rgb_lcd::setCursor(uint8_t col, uint8_t row)
 {
 
     col = (row == 0 ? col|0x80 : col|0xc0);
-    unsigned char dta[2] = {0x80, col};
-
-    i2c_send_byteS(dta, 2);
+    send(LCD_CONTROL_COMMAND, col);
 
 }
 
@@ -221,15 +215,7 @@ void rgb_lcd::createChar(uint8_t location, uint8_t charmap[])
 
     location &= 0x7; // we only have 8 locations 0-7
     command(LCD_SETCGRAMADDR | (location << 3));
-    
-    
-    unsigned char dta[9];
-    dta[0] = 0x40;
-    for(int i=0; i<8; i++)
-    {
-        dta[i+1] = charmap[i];
-    }
-    i2c_send_byteS(dta, 9);
+    writeData(charmap, 8);
 }
 
 /*********** mid level commands, for sending data/cmds */
@@ -237,25 +223,149 @@ void rgb_lcd::createChar(uint8_t location, uint8_t charmap[])
 // send command
 inline void rgb_lcd::command(uint8_t value)
 {
-    unsigned char dta[2] = {0x80, value};
-    i2c_send_byteS(dta, 2);
+    send(LCD_CONTROL_COMMAND, value);
 }
 
 // send data
 inline size_t rgb_lcd::write(uint8_t value)
 {
-
-    unsigned char dta[2] = {0x40, value};
-    i2c_send_byteS(dta, 2);
+    send(LCD_CONTROL_DATA, value);
     return 1; // assume sucess
 }
 
+// Print's string/number path: one data-stream transaction per string instead of one per character
+size_t rgb_lcd::write(const uint8_t *buffer, size_t size)
+{
+    return writeData(buffer, size);
+}
+
+// send a run of data bytes, as few transactions as the Wire buffer allows
+size_t rgb_lcd::writeData(const uint8_t *buffer, size_t size)
+{
+    unsigned char dta[LCD_I2C_MAX_TRANSFER];
+    dta[0] = LCD_CONTROL_DATA;
+
+    size_t sent = 0;
+    while(sent < size)
+    {
+        unsigned char len = 0;
+        while(len < LCD_I2C_MAX_TRANSFER - 1 && sent < size)
+        {
+            dta[++len] = buffer[sent++];
+        }
+
+        if(_async)
+        {
+            enqueue(LCD_ADDRESS, dta, len + 1, I2C_PRIORITY_HIGH, true);
+        }
+        else
+        {
+            i2c_send_byteS(dta, len + 1);
+        }
+    }
+    return size;
+}
+
+// send a command or data byte, or queue it when running asynchronously
+void rgb_lcd::send(uint8_t control, uint8_t value)
+{
+    unsigned char dta[2] = {control, value};
+
+    if(_async)
+    {
+        // data bytes can ride along with data already waiting in the queue
+        enqueue(LCD_ADDRESS, dta, 2, I2C_PRIORITY_HIGH, control == LCD_CONTROL_DATA);
+    }
+    else
+    {
+        i2c_send_byteS(dta, 2);
+    }
+}
+
+void rgb_lcd::enqueue(uint8_t address, const uint8_t *data, uint8_t length, I2CPriority priority, bool mergeable)
+{
+    if(!_queue.enqueue(address, data, length, priority, mergeable))
+    {
+        // queue is full: drop the write rather than wait for the bus, and let the caller find out
+        _droppedWrites++;
+    }
+}
+
+// the controller needs 'us' microseconds before it takes the next byte
+void rgb_lcd::holdOff(uint32_t us)
+{
+    if(_async)
+    {
+        if(!_queue.holdOff(LCD_ADDRESS, us))
+        {
+            // nowhere to keep the wait, so whatever follows can't be trusted to land
+            _droppedWrites++;
+        }
+    }
+    else
+    {
+        delayMicroseconds(us);
+    }
+}
+
+rgb_lcd::BusStats rgb_lcd::busStats()
+{
+    return I2CQueue::busStats();
+}
+
+void rgb_lcd::resetBusStats()
+{
+    I2CQueue::resetBusStats();
+}
+
+void rgb_lcd::setAsync(bool enabled)
+{
+    if(!enabled)
+    {
+        while(!_queue.empty() || _queue.deviceBusy(LCD_ADDRESS))
+        {
+            _queue.poll(I2C_QUEUE_HIGH_SLOTS);
+        }
+    }
+    _async = enabled;
+}
+
+uint32_t rgb_lcd::droppedWrites() const
+{
+    return _droppedWrites;
+}
+
+bool rgb_lcd::busy()
+{
+    return _queue.pending(LCD_ADDRESS) || _queue.deviceBusy(LCD_ADDRESS);
+}
+
+void rgb_lcd::update()
+{
+    _queue.poll(LCD_UPDATE_BUDGET);
+}
+
+I2CQueue &rgb_lcd::queue()
+{
+    return _queue;
+}
+
 void rgb_lcd::setReg(unsigned char addr, unsigned char dta)
 {
-    Wire.beginTransmission(RGB_ADDRESS); // transmit to device #4
-    Wire.write(addr);
-    Wire.write(dta);
-    Wire.endTransmission();    // stop transmitting
+    unsigned char buf[2] = {addr, dta};
+
+    if(_async)
+    {
+        // backlight changes can always wait behind text, and only the newest value of a register matters
+        if(!_queue.enqueueLatest(RGB_ADDRESS, buf, 2, I2C_PRIORITY_LOW))
+        {
+            _droppedWrites++;
+        }
+    }
+    else
+    {
+        I2CQueue::transmit(RGB_ADDRESS, buf, 2);
+    }
 }
 
 void rgb_lcd::setRGB(unsigned char r, unsigned char g, unsigned char b)
@@ -35,10 +35,22 @@
 #include "Print.h"
 #endif
 
+#include "I2CQueue.h"
+
 // Device I2C Arress
 #define LCD_ADDRESS     (0x7c>>1)
 #define RGB_ADDRESS     (0xc4>>1)
 
+// Largest I2C transaction the Wire buffer can hold (control byte included)
+#define LCD_I2C_MAX_TRANSFER I2C_QUEUE_MAX_PAYLOAD
+
+// I2C control bytes: what follows is a command / display data
+#define LCD_CONTROL_COMMAND 0x80
+#define LCD_CONTROL_DATA    0x40
+
+// Queued transactions update() may put on the bus per call
+#define LCD_UPDATE_BUDGET 4
+
 
 // color define 
 #define WHITE           0
@@ -120,6 +132,8 @@ public:
   void setCursor(uint8_t, uint8_t); 
   
   virtual size_t write(uint8_t);
+  virtual size_t write(const uint8_t *, size_t);
+  size_t writeData(const uint8_t *, size_t);
   void command(uint8_t);
   
   // color control
@@ -131,9 +145,27 @@ public:
   void setColorWhite(){setRGB(255, 255, 255);}
   
   using Print::write;
+
+  // asynchronous mode: all LCD and backlight traffic goes through an I2CQueue. slow commands
+  // (clear, home, begin's power-up waits) hold the LCD off instead of spinning, and text always
+  // goes out ahead of backlight changes. call update() regularly (e.g. every loop) to drain it.
+  // nothing here ever waits for the bus: a write that finds the queue full is dropped and
+  // counted in droppedWrites(), so whoever draws the screen knows to redraw it.
+  void setAsync(bool enabled);
+  bool busy();
+  uint32_t droppedWrites() const;
+  void update();
+  I2CQueue &queue();
+
+  // I2C traffic generated by the library (LCD and backlight), for benchmarking
+  typedef I2CBusStats BusStats;
+  static BusStats busStats();
+  static void resetBusStats();
   
 private:
   void send(uint8_t, uint8_t);
+  void enqueue(uint8_t address, const uint8_t *data, uint8_t length, I2CPriority priority, bool mergeable = false);
+  void holdOff(uint32_t us);
   void setReg(unsigned char addr, unsigned char dta);
 
   uint8_t _displayfunction;
@@ -143,6 +175,10 @@ private:
   uint8_t _initialized;
 
   uint8_t _numlines,_currline;
+
+  bool _async;
+  uint32_t _droppedWrites;
+  I2CQueue _queue;
 };
 
 #endif
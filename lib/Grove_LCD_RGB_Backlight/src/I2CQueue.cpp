@@ -0,0 +1,263 @@
+/*
+  I2CQueue.cpp
+  Fixed-size, allocation-free queue of I2C write transactions for devices sharing one Wire bus.
+*/
+
+#if defined (PARTICLE)
+// Nothing required if Spark
+#else
+#include <Arduino.h>
+#include <string.h>
+#include <Wire.h>
+#endif
+
+#include "I2CQueue.h"
+
+static I2CBusStats bus_stats = {0, 0, 0};
+
+I2CQueue::I2CQueue()
+{
+    _rings[I2C_PRIORITY_HIGH].slots = _highSlots;
+    _rings[I2C_PRIORITY_HIGH].capacity = I2C_QUEUE_HIGH_SLOTS;
+    _rings[I2C_PRIORITY_LOW].slots = _lowSlots;
+    _rings[I2C_PRIORITY_LOW].capacity = I2C_QUEUE_LOW_SLOTS;
+
+    for(int p=0; p<I2C_PRIORITY_COUNT; p++)
+    {
+        _rings[p].head = 0;
+        _rings[p].count = 0;
+    }
+
+    for(int i=0; i<I2C_QUEUE_MAX_DEVICES; i++)
+    {
+        _holdOffs[i].duration = 0;
+    }
+}
+
+bool I2CQueue::enqueue(uint8_t address, const uint8_t *data, uint8_t length, I2CPriority priority, bool mergeable)
+{
+    if(length == 0 || length > I2C_QUEUE_MAX_PAYLOAD)
+    {
+        return false;
+    }
+
+    Ring &ring = _rings[priority];
+    Transaction *last = newest(ring);
+    if(mergeable && last != NULL && last->mergeable && last->holdOffUs == 0 &&
+       last->address == address && last->data[0] == data[0] &&
+       last->length + length - 1 <= I2C_QUEUE_MAX_PAYLOAD)
+    {
+        memcpy(&last->data[last->length], &data[1], length - 1);
+        last->length += length - 1;
+        return true;
+    }
+
+    if(ring.count == ring.capacity)
+    {
+        return false;
+    }
+
+    Transaction &slot = ring.slots[(ring.head + ring.count) % ring.capacity];
+    slot.address = address;
+    slot.length = length;
+    slot.mergeable = mergeable;
+    slot.holdOffUs = 0;
+    memcpy(slot.data, data, length);
+    ring.count++;
+    return true;
+}
+
+bool I2CQueue::enqueueLatest(uint8_t address, const uint8_t *data, uint8_t length, I2CPriority priority)
+{
+    Ring &ring = _rings[priority];
+    for(int i=ring.count-1; i>=0; i--)
+    {
+        Transaction &t = ring.slots[(ring.head + i) % ring.capacity];
+        if(t.address == address && t.length == length && t.data[0] == data[0])
+        {
+            memcpy(t.data, data, length);
+            return true;
+        }
+    }
+
+    return enqueue(address, data, length, priority);
+}
+
+bool I2CQueue::holdOff(uint8_t address, uint32_t us)
+{
+    // attach the wait to the newest transaction still queued for this device, if any
+    for(int p=0; p<I2C_PRIORITY_COUNT; p++)
+    {
+        Ring &ring = _rings[p];
+        for(int i=ring.count-1; i>=0; i--)
+        {
+            Transaction &t = ring.slots[(ring.head + i) % ring.capacity];
+            if(t.address == address)
+            {
+                uint32_t total = t.holdOffUs + us;
+                t.holdOffUs = total > 0xFFFF ? 0xFFFF : total;
+                return true;
+            }
+        }
+    }
+
+    return startHoldOff(address, us);
+}
+
+uint8_t I2CQueue::poll(uint8_t maxTransactions)
+{
+    uint8_t sent = 0;
+    while(sent < maxTransactions)
+    {
+        // highest priority ring whose oldest transaction can go right now
+        Ring *ready = NULL;
+        for(int p=0; p<I2C_PRIORITY_COUNT; p++)
+        {
+            Ring &ring = _rings[p];
+            if(ring.count > 0 && canSend(ring.slots[ring.head]))
+            {
+                ready = &ring;
+                break;
+            }
+        }
+
+        if(ready == NULL)
+        {
+            break;
+        }
+
+        Transaction &t = ready->slots[ready->head];
+        transmit(t.address, t.data, t.length);
+        if(t.holdOffUs)
+        {
+            startHoldOff(t.address, t.holdOffUs);
+        }
+
+        ready->head = (ready->head + 1) % ready->capacity;
+        ready->count--;
+        sent++;
+    }
+    return sent;
+}
+
+bool I2CQueue::empty() const
+{
+    return _rings[I2C_PRIORITY_HIGH].count == 0 && _rings[I2C_PRIORITY_LOW].count == 0;
+}
+
+bool I2CQueue::full(I2CPriority priority) const
+{
+    return _rings[priority].count == _rings[priority].capacity;
+}
+
+bool I2CQueue::pending(uint8_t address) const
+{
+    for(int p=0; p<I2C_PRIORITY_COUNT; p++)
+    {
+        const Ring &ring = _rings[p];
+        for(int i=0; i<ring.count; i++)
+        {
+            if(ring.slots[(ring.head + i) % ring.capacity].address == address)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool I2CQueue::deviceBusy(uint8_t address)
+{
+    for(int i=0; i<I2C_QUEUE_MAX_DEVICES; i++)
+    {
+        DeviceHoldOff &h = _holdOffs[i];
+        if(h.duration != 0 && h.address == address)
+        {
+            if((uint32_t)(micros() - h.start) < h.duration)
+            {
+                return true;
+            }
+            h.duration = 0;     // expired; don't let micros() wrapping bring it back
+        }
+    }
+    return false;
+}
+
+// a transaction can go once its device is free, and if it asks for a hold-off, once there is
+// somewhere to keep it - otherwise it stays queued rather than anything waiting for the slot
+bool I2CQueue::canSend(const Transaction &t)
+{
+    return !deviceBusy(t.address) && (t.holdOffUs == 0 || holdOffSlot(t.address) != NULL);
+}
+
+// the slot holding 'address' off, else a free one, else NULL
+I2CQueue::DeviceHoldOff *I2CQueue::holdOffSlot(uint8_t address)
+{
+    DeviceHoldOff *slot = NULL;
+    for(int i=0; i<I2C_QUEUE_MAX_DEVICES; i++)
+    {
+        DeviceHoldOff &h = _holdOffs[i];
+        if(h.duration != 0 && (uint32_t)(micros() - h.start) >= h.duration)
+        {
+            h.duration = 0;
+        }
+        if(h.duration != 0 && h.address == address)
+        {
+            return &h;
+        }
+        if(slot == NULL && h.duration == 0)
+        {
+            slot = &h;
+        }
+    }
+    return slot;
+}
+
+bool I2CQueue::startHoldOff(uint8_t address, uint32_t us)
+{
+    DeviceHoldOff *slot = holdOffSlot(address);
+    if(slot == NULL)
+    {
+        return false;
+    }
+
+    slot->address = address;
+    slot->start = micros();
+    slot->duration = us;
+    return true;
+}
+
+I2CQueue::Transaction *I2CQueue::newest(Ring &ring)
+{
+    if(ring.count == 0)
+    {
+        return NULL;
+    }
+    return &ring.slots[(ring.head + ring.count - 1) % ring.capacity];
+}
+
+void I2CQueue::transmit(uint8_t address, const uint8_t *data, uint8_t length)
+{
+    uint32_t start = micros();
+    Wire.beginTransmission(address);
+    for(int i=0; i<length; i++)
+    {
+        Wire.write(data[i]);
+    }
+    Wire.endTransmission();
+    bus_stats.micros += micros() - start;
+    bus_stats.transactions++;
+    bus_stats.bytes += length + 1;     // address + payload
+}
+
+I2CBusStats I2CQueue::busStats()
+{
+    return bus_stats;
+}
+
+void I2CQueue::resetBusStats()
+{
+    bus_stats.transactions = 0;
+    bus_stats.bytes = 0;
+    bus_stats.micros = 0;
+}
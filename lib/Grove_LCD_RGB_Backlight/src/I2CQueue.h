@@ -0,0 +1,114 @@
+/*
+  I2CQueue.h
+  Fixed-size, allocation-free queue of I2C write transactions for devices sharing one Wire bus.
+
+  Transactions are queued by the caller and pushed out a few at a time from poll(), so
+  slow bus traffic is spread across loop() passes instead of stalling one of them.
+  Each transaction can ask for a hold-off before the same device is addressed again
+  (e.g. the ~2ms an HD44780 needs after clear), which only holds back that device.
+  Nothing here ever waits: a transaction whose hold-off has nowhere to be kept stays queued
+  until a device's hold-off runs out.
+  High priority traffic always goes first while it is ready to go.
+*/
+
+#ifndef __I2C_QUEUE_H__
+#define __I2C_QUEUE_H__
+
+#if defined (PARTICLE)
+#include "Particle.h"
+#else
+#include <Arduino.h>
+#include <inttypes.h>
+#endif
+
+#define I2C_QUEUE_MAX_PAYLOAD   32      // Matches the Wire buffer
+#define I2C_QUEUE_HIGH_SLOTS    16
+#define I2C_QUEUE_LOW_SLOTS     6
+#define I2C_QUEUE_MAX_DEVICES   2       // Devices that can be held off at the same time: the LCD and its backlight
+
+enum I2CPriority
+{
+  I2C_PRIORITY_HIGH = 0,
+  I2C_PRIORITY_LOW,
+  I2C_PRIORITY_COUNT
+};
+
+struct I2CBusStats
+{
+  uint32_t transactions;
+  uint32_t bytes;         // bytes on the bus, address byte included
+  uint32_t micros;        // time spent inside Wire transactions
+};
+
+class I2CQueue
+{
+public:
+  I2CQueue();
+
+  // Queue a write. With mergeable set, the payload (minus its first byte) is appended to the
+  // newest queued transaction if that one went to the same address, starts with the same
+  // byte, was also mergeable and has room - e.g. LCD data bytes after a 0x40 control byte.
+  // Returns false if the queue for that priority is full.
+  bool enqueue(uint8_t address, const uint8_t *data, uint8_t length, I2CPriority priority, bool mergeable = false);
+
+  // Queue a write where only the newest value matters, e.g. a register: if a transaction of the
+  // same length for 'address' starting with the same byte is still queued, its payload is
+  // replaced instead. Returns false if there was none and the queue for that priority is full.
+  bool enqueueLatest(uint8_t address, const uint8_t *data, uint8_t length, I2CPriority priority);
+
+  // The device at 'address' needs 'us' microseconds before its next transaction. If something
+  // for it is still queued, the wait starts after the newest of those goes out. Returns false if
+  // nothing is queued for it and I2C_QUEUE_MAX_DEVICES other devices are already held off.
+  bool holdOff(uint8_t address, uint32_t us);
+
+  // Send up to maxTransactions ready transactions. Returns how many went out.
+  uint8_t poll(uint8_t maxTransactions);
+
+  bool empty() const;
+  bool full(I2CPriority priority) const;
+  bool pending(uint8_t address) const;
+  bool deviceBusy(uint8_t address);
+
+  // Synchronous write that still shows up in the bus statistics
+  static void transmit(uint8_t address, const uint8_t *data, uint8_t length);
+
+  static I2CBusStats busStats();
+  static void resetBusStats();
+
+private:
+  struct Transaction
+  {
+    uint8_t address;
+    uint8_t length;
+    bool mergeable;
+    uint16_t holdOffUs;
+    uint8_t data[I2C_QUEUE_MAX_PAYLOAD];
+  };
+
+  struct Ring
+  {
+    Transaction *slots;
+    uint8_t capacity;
+    uint8_t head;
+    uint8_t count;
+  };
+
+  struct DeviceHoldOff
+  {
+    uint8_t address;
+    uint32_t start;
+    uint32_t duration;
+  };
+
+  Transaction *newest(Ring &ring);
+  bool canSend(const Transaction &t);
+  DeviceHoldOff *holdOffSlot(uint8_t address);
+  bool startHoldOff(uint8_t address, uint32_t us);
+
+  Transaction _highSlots[I2C_QUEUE_HIGH_SLOTS];
+  Transaction _lowSlots[I2C_QUEUE_LOW_SLOTS];
+  Ring _rings[I2C_PRIORITY_COUNT];
+  DeviceHoldOff _holdOffs[I2C_QUEUE_MAX_DEVICES];
+};
+
+#endif
@@ -76,14 +76,25 @@
 #endif // SYSTEM_VERSION < SYSTEM_VERSION_ALPHA(5,0,0,2)
   #define pinLO(_pin) (nrf_gpio_pin_clear(NRF_GPIO_PIN_MAP(PIN_MAP2[_pin].gpio_port, PIN_MAP2[_pin].gpio_pin)))
   #define pinHI(_pin) (nrf_gpio_pin_set(NRF_GPIO_PIN_MAP(PIN_MAP2[_pin].gpio_port, PIN_MAP2[_pin].gpio_pin)))
+#elif PLATFORM_ID == 3 // gcc virtual device (host builds), which has no GPIO to drive
+  #define pinLO(_pin) ((void)(_pin))
+  #define pinHI(_pin) ((void)(_pin))
 #else
   #error "*** PLATFORM_ID not supported by this library. PLATFORM should be Particle Core, Photon, Electron, Argon, Boron, Xenon, RedBear Duo, B SoM, B5 SoM, E SoM X or Tracker ***"
 #endif
 // fast pin access
 #define pinSet(_pin, _hilo) (_hilo ? pinHI(_pin) : pinLO(_pin))
 
+// Pack up to 4 bytes of a pixel so a change can be detected with one compare
+static inline uint32_t getPixelBytes(const uint8_t *p, uint8_t count) {
+  uint32_t v = 0;
+  memcpy(&v, p, count);
+  return v;
+}
+
 Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, uint8_t p, uint8_t t) :
-  begun(false), type(t), brightness(0), pixels(NULL), endTime(0)
+  begun(false), dirty(true), type(t), brightness(0), pixels(NULL), endTime(0),
+  spi(NULL), spiBuffer(NULL), spiClock(0)
 {
   updateLength(n);
   setPin(p);
@@ -91,6 +102,7 @@ Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, uint8_t p, uint8_t t) :
 
 Adafruit_NeoPixel::~Adafruit_NeoPixel() {
   if (pixels) free(pixels);
+  if (spiBuffer) free(spiBuffer);
   if (begun) pinMode(pin, INPUT);
 }
 
@@ -113,12 +125,15 @@ void Adafruit_NeoPixel::updateLength(uint16_t n) {
   } else {
     numLEDs = numBytes = 0;
   }
+  if (spi && !allocSPIBuffer()) setOutputBitBang();
+  dirty = true;
 }
 
 void Adafruit_NeoPixel::begin(void) {
   pinMode(pin, OUTPUT);
   digitalWrite(pin, LOW);
   begun = true;
+  dirty = true;
 }
 
 // Set the output pin number
@@ -131,17 +146,27 @@ void Adafruit_NeoPixel::setPin(uint8_t p) {
         pinMode(p, OUTPUT);
         digitalWrite(p, LOW);
     }
+    dirty = true;
 }
 
+// Only push the frame out if something changed since the last show(). Sending
+// a frame masks interrupts for its whole duration, so skipping identical
+// frames keeps the rest of the system responsive when show() runs every loop.
+// A frame that comes before the previous one has latched is left for a later
+// call rather than waited for, so show() never spins either.
 void Adafruit_NeoPixel::show(void) {
-  if(!pixels) return;
+  if(!dirty || !canShow()) return;
+  forceShow();
+}
 
-  // Data latch = 24 or 50 microsecond pause in the output stream.  Rather than
-  // put a delay at the end of the function, the ending time is noted and
-  // the function will simply hold off (if needed) on issuing the
-  // subsequent round of data until the latch time has elapsed.  This
-  // allows the mainline code to start generating the next frame of data
-  // rather than stalling for the latch.
+// True once the latch after the last frame has passed. Signed, since with SPI
+// output endTime is when the DMA frame ends, which may still be ahead of us.
+bool Adafruit_NeoPixel::canShow(void) const {
+  return (int32_t)(micros() - endTime) >= (int32_t)latchTime();
+}
+
+// Data latch = 24 to 500 microsecond pause in the output stream, by pixel type
+uint32_t Adafruit_NeoPixel::latchTime(void) const {
   uint32_t wait_time; // wait time in microseconds.
   switch(type) {
     case TM1803: { // TM1803 = 24us reset pulse
@@ -164,7 +189,24 @@ void Adafruit_NeoPixel::show(void) {
         wait_time = 50L;
       } break;
   }
-  while((micros() - endTime) < wait_time);
+  return wait_time;
+}
+
+// Send the frame unconditionally, e.g. to restore pixels after a glitch
+void Adafruit_NeoPixel::forceShow(void) {
+  if(!pixels) return;
+
+  // Rather than put a delay at the end of the function, the ending time is
+  // noted and the function will simply hold off (if needed) on issuing the
+  // subsequent round of data until the latch time has elapsed.  This
+  // allows the mainline code to start generating the next frame of data
+  // rather than stalling for the latch.
+  while(!canShow());
+  if(spi) {
+    showSPI();
+    dirty = false;
+    return;
+  }
   // endTime is a private member (rather than global var) so that multiple
   // instances on different pins can be quickly issued in succession (each
   // instance doesn't delay the next).
@@ -1102,6 +1144,70 @@ void Adafruit_NeoPixel::show(void) {
 
 #endif
   endTime = micros(); // Save EOD time for latch on next call
+  dirty = false;
+}
+
+// Nothing to do when a DMA frame completes; canShow() works out from endTime
+// whether the previous frame (and its latch) is done.
+static void spiTransferDone(void) {
+}
+
+bool Adafruit_NeoPixel::allocSPIBuffer(void) {
+  if (spiBuffer) free(spiBuffer);
+  spiBuffer = numBytes ? (uint8_t *)malloc((uint32_t)numBytes * NEO_SPI_BITS_PER_BIT) : NULL;
+  return spiBuffer != NULL;
+}
+
+bool Adafruit_NeoPixel::setOutputSPI(SPIClass &s) {
+  spi = &s;
+  if (!allocSPIBuffer()) {
+    setOutputBitBang();
+    return false;
+  }
+
+  spiClock = (type == WS2811 || type == TM1803) ? NEO_SPI_CLOCK_400KHZ : NEO_SPI_CLOCK_800KHZ;
+  spi->begin();
+  spi->setBitOrder(MSBFIRST);
+  spi->setDataMode(SPI_MODE0);
+  spi->setClockSpeed(spiClock);
+  dirty = true;
+  return true;
+}
+
+void Adafruit_NeoPixel::setOutputBitBang(void) {
+  spi = NULL;
+  if (spiBuffer) free(spiBuffer);
+  spiBuffer = NULL;
+  dirty = true;
+}
+
+uint32_t Adafruit_NeoPixel::encodeSPI(const uint8_t *in, uint16_t numBytes, uint8_t type, uint8_t *out) {
+  // One nibble per data bit: 1000 for a 0, and for a 1 whichever of 1110 and
+  // 1100 comes closer to the part's '1' high time (see the timings in forceShow()).
+  // WS2811 and TM1803 are clocked at half the rate, so each SPI bit is 533ns.
+  const uint8_t zero = 0x8; // 1000
+  const uint8_t one = (type == WS2811 || type == SK6812RGBW) ? 0xC : 0xE; // 1100 : 1110
+  // TM1829 idles high and expects the whole waveform inverted
+  const uint8_t invert = (type == TM1829) ? 0xFF : 0x00;
+
+  uint8_t *o = out;
+  for(uint16_t i=0; i<numBytes; i++) {
+    uint8_t c = in[i];
+    for(uint8_t k=0; k<4; k++) {
+      *o++ = ((((c & 0x80) ? one : zero) << 4) | ((c & 0x40) ? one : zero)) ^ invert;
+      c <<= 2;
+    }
+  }
+  return (uint32_t)(o - out);
+}
+
+void Adafruit_NeoPixel::showSPI(void) {
+  uint32_t length = encodeSPI(pixels, numBytes, type, spiBuffer);
+  uint32_t frameUs = (uint32_t)(((uint64_t)length * 8 * 1000000) / spiClock) + 1;
+
+  // With a completion callback the transfer runs on DMA and returns right away
+  spi->transfer(spiBuffer, NULL, length, spiTransferDone);
+  endTime = micros() + frameUs;
 }
 
 // Set pixel color from separate R,G,B components:
@@ -1114,6 +1220,8 @@ void Adafruit_NeoPixel::setPixelColor(
       b = (b * brightness) >> 8;
     }
     uint8_t *p = &pixels[n * 3];
+    uint8_t *pixel = p;
+    uint32_t old = getPixelBytes(pixel, 3);
     switch(type) {
       case WS2812B: // WS2812, WS2812B & WS2813 is GRB order.
       case WS2812B_FAST:
@@ -1137,6 +1245,7 @@ void Adafruit_NeoPixel::setPixelColor(
           *p = b;
         } break;
     }
+    if(getPixelBytes(pixel, 3) != old) dirty = true;
   }
 }
 
@@ -1150,7 +1259,10 @@ void Adafruit_NeoPixel::setPixelColor(
       b = (b * brightness) >> 8;
       w = (w * brightness) >> 8;
     }
-    uint8_t *p = &pixels[n * (type==SK6812RGBW?4:3)];
+    uint8_t bytesPerPixel = (type==SK6812RGBW?4:3);
+    uint8_t *p = &pixels[n * bytesPerPixel];
+    uint8_t *pixel = p;
+    uint32_t old = getPixelBytes(pixel, bytesPerPixel);
     switch(type) {
       case WS2812B: // WS2812, WS2812B & WS2813 is GRB order.
       case WS2812B_FAST:
@@ -1180,6 +1292,7 @@ void Adafruit_NeoPixel::setPixelColor(
           *p = b;
         } break;
     }
+    if(getPixelBytes(pixel, bytesPerPixel) != old) dirty = true;
   }
 }
 
@@ -1196,7 +1309,10 @@ void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint32_t c) {
       g = (g * brightness) >> 8;
       b = (b * brightness) >> 8;
     }
-    uint8_t *p = &pixels[n * (type==SK6812RGBW?4:3)];
+    uint8_t bytesPerPixel = (type==SK6812RGBW?4:3);
+    uint8_t *p = &pixels[n * bytesPerPixel];
+    uint8_t *pixel = p;
+    uint32_t old = getPixelBytes(pixel, bytesPerPixel);
     switch(type) {
       case WS2812B: // WS2812, WS2812B & WS2813 is GRB order.
       case WS2812B_FAST:
@@ -1227,6 +1343,7 @@ void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint32_t c) {
           *p = b;
         } break;
     }
+    if(getPixelBytes(pixel, bytesPerPixel) != old) dirty = true;
   }
 }
 
@@ -1294,7 +1411,7 @@ uint32_t Adafruit_NeoPixel::getPixelColor(uint16_t n) const {
         c = ((uint32_t)p[0] << 16) | ((uint32_t)p[2] <<  8) | (uint32_t)p[1];
       } break;
     case SK6812RGBW: { // SK6812RGBW is RGBW order, but returns packed WRGB color
-        c = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] <<  8) | (uint32_t)p[3];
+        c = ((uint32_t)p[3] << 24) | ((uint32_t)p[0] << 16) | ((uint32_t)p[1] <<  8) | (uint32_t)p[2];
       } break;
     case WS2811: // WS2811 is RGB order
     case TM1803: // TM1803 is RGB order
@@ -1318,7 +1435,9 @@ uint32_t Adafruit_NeoPixel::getPixelColor(uint16_t n) const {
   return c; // Pixel # is out of bounds
 }
 
+// The caller may write straight into the buffer, so assume it will
 uint8_t *Adafruit_NeoPixel::getPixels(void) const {
+  dirty = true;
   return pixels;
 }
 
@@ -1364,6 +1483,7 @@ void Adafruit_NeoPixel::setBrightness(uint8_t b) {
       *ptr++ = (c * scale) >> 8;
     }
     brightness = newBrightness;
+    dirty = true;
   }
 }
 
@@ -1373,5 +1493,11 @@ uint8_t Adafruit_NeoPixel::getBrightness(void) const {
 }
 
 void Adafruit_NeoPixel::clear(void) {
-  memset(pixels, 0, numBytes);
+  for(uint16_t i=0; i<numBytes; i++) {
+    if(pixels[i]) {
+      memset(pixels, 0, numBytes);
+      dirty = true;
+      break;
+    }
+  }
 }
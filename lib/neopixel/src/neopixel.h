@@ -68,6 +68,12 @@
 #define WS2812B_FAST   0x07 // 800 KHz datastream (NeoPixel)
 #define WS2812B2_FAST  0x08 // 800 KHz datastream (NeoPixel)
 
+// SPI output: every data bit is sent as 4 SPI bits (1000 for 0, 1110/1100 for 1)
+// on MOSI, clocked as close to 4x the pixel data rate as the SPI dividers allow.
+#define NEO_SPI_BITS_PER_BIT  4
+#define NEO_SPI_CLOCK_800KHZ  3750000 // 267ns per SPI bit
+#define NEO_SPI_CLOCK_400KHZ  1875000 // 533ns per SPI bit
+
 class Adafruit_NeoPixel {
 
  public:
@@ -78,7 +84,8 @@ class Adafruit_NeoPixel {
 
   void
     begin(void),
-    show(void) __attribute__((optimize("Ofast"))),
+    show(void),
+    forceShow(void) __attribute__((optimize("Ofast"))),
     setPin(uint8_t p),
     setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b),
     setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t w),
@@ -91,7 +98,17 @@ class Adafruit_NeoPixel {
     setColorDimmed(uint16_t aLedNumber, byte aRed, byte aGreen, byte aBlue, byte aBrightness),
     setColorDimmed(uint16_t aLedNumber, byte aRed, byte aGreen, byte aBlue, byte aWhite, byte aBrightness),
     updateLength(uint16_t n),
-    clear(void);
+    clear(void),
+    setOutputBitBang(void);
+  // Drive the strip from the MOSI pin of 'spi' using DMA instead of bit-banging the
+  // pin with interrupts masked. The strip must be wired to that MOSI pin. Returns
+  // false (and keeps bit-banging) if the SPI frame buffer can't be allocated.
+  bool
+    setOutputSPI(SPIClass &spi);
+  // Encode numBytes of pixel data for the given pixel type into out, which needs
+  // room for numBytes * NEO_SPI_BITS_PER_BIT bytes. Returns the bytes written.
+  static uint32_t
+    encodeSPI(const uint8_t *in, uint16_t numBytes, uint8_t type, uint8_t *out);
   uint8_t
    *getPixels() const,
     getBrightness(void) const,
@@ -105,6 +122,8 @@ class Adafruit_NeoPixel {
     Color(uint8_t r, uint8_t g, uint8_t b, uint8_t w);
   uint32_t
     getPixelColor(uint16_t n) const;
+  bool
+    canShow(void) const;
   byte
     brightnessToPWM(byte aBrightness);
 
@@ -112,6 +131,8 @@ class Adafruit_NeoPixel {
 
   bool
     begun;         // true if begin() previously called
+  mutable bool
+    dirty;         // pixel data changed since the last show()
   uint16_t
     numLEDs,       // Number of RGB LEDs in strip
     numBytes;      // Size of 'pixels' buffer below
@@ -122,7 +143,20 @@ class Adafruit_NeoPixel {
     brightness,
    *pixels;        // Holds LED color values (3 bytes each)
   uint32_t
-    endTime;       // Latch timing reference
+    endTime;       // Latch timing reference; end of the DMA frame with SPI output
+  SPIClass
+   *spi;           // SPI output, or NULL to bit-bang 'pin'
+  uint8_t
+   *spiBuffer;     // Encoded SPI frame, handed to DMA
+  uint32_t
+    spiClock;      // SPI clock in Hz
+
+  uint32_t
+    latchTime(void) const;
+  void
+    showSPI(void);
+  bool
+    allocSPIBuffer(void);
 };
 
 #endif // PARTICLE_NEOPIXEL_H
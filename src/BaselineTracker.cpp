@@ -0,0 +1,61 @@
+#include "BaselineTracker.h"
+
+BaselineTracker::BaselineTracker()
+{
+  reset();
+}
+
+void BaselineTracker::reset() {
+  filter.reset();
+  baseline = 0;
+  seeded = false;
+  windowCount = 0;
+}
+
+void BaselineTracker::seed(int32_t rawQ) {
+  baseline = rawQ;
+  seeded = true;
+}
+
+void BaselineTracker::addSamples(const uint16_t *samples, uint16_t count) {
+  for (uint16_t i = 0; i < count; i++) {
+    int32_t filtered;
+    if (filter.process(samples[i], filtered)) {
+      update(filtered);
+    }
+  }
+}
+
+void BaselineTracker::update(int32_t value) {
+  int32_t target = value << BASELINE_FRAC_BITS;
+  windowCount++;
+
+  if (!seeded) {
+    baseline = target;
+    seeded = true;
+    return;
+  }
+
+  int32_t delta = target - baseline;
+  baseline += delta >> (delta < 0 ? BASELINE_FALL_SHIFT : BASELINE_RISE_SHIFT);
+}
+
+bool BaselineTracker::valid() const {
+  return seeded;
+}
+
+int32_t BaselineTracker::rawQ() const {
+  return baseline;
+}
+
+uint16_t BaselineTracker::raw() const {
+  return (baseline + (1 << (BASELINE_FRAC_BITS - 1))) >> BASELINE_FRAC_BITS;
+}
+
+int32_t BaselineTracker::ppm() const {
+  return MQ3FixedConverter::ppm(raw());
+}
+
+uint32_t BaselineTracker::windows() const {
+  return windowCount;
+}
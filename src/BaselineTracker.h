@@ -0,0 +1,46 @@
+#ifndef BASELINE_TRACKER_H
+#define BASELINE_TRACKER_H
+
+#include <stdint.h>
+#include "BreathSession.h"
+
+#define BASELINE_FRAC_BITS 8
+#define BASELINE_RISE_SHIFT 8     // Rises with weight 1/256 per window (~50s time constant at 200ms windows)
+#define BASELINE_FALL_SHIFT 3     // Falls with weight 1/8 (~1.6s), so it hugs the cleanest air seen
+
+// Clean-air level of the MQ3, tracked in the background while the device is idle.
+// It is an asymmetric exponential filter: it follows the signal down quickly and up only very
+// slowly, so it sits near the recent minimum and a breath (or someone else's drink nearby)
+// barely moves it, while heater ageing and temperature drift are followed over a few minutes.
+// Kept in raw ADC counts with BASELINE_FRAC_BITS of fraction so it can be stored and restored.
+class BaselineTracker
+{
+public:
+  BaselineTracker();
+
+  void reset();
+
+  // Start from a previously stored baseline instead of the first window seen
+  void seed(int32_t rawQ);
+
+  void addSamples(const uint16_t *samples, uint16_t count);
+
+  bool valid() const;
+  int32_t rawQ() const;
+  uint16_t raw() const;
+
+  // Baseline in PPM, Q16.16 like MQ3FixedConverter::ppm()
+  int32_t ppm() const;
+
+  uint32_t windows() const;
+
+private:
+  void update(int32_t value);
+
+  MQ3Filter filter;
+  int32_t baseline;
+  bool seeded;
+  uint32_t windowCount;
+};
+
+#endif // BASELINE_TRACKER_H
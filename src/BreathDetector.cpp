@@ -0,0 +1,100 @@
+#include "BreathDetector.h"
+
+BreathDetector::BreathDetector()
+{
+  reset();
+}
+
+void BreathDetector::reset() {
+  current = BREATH_WAITING;
+  restQ = 0;
+  noise = 0;
+  previous = 0;
+  windowCount = 0;
+  onset = 0;
+  end = 0;
+  highWindows = 0;
+  flatWindows = 0;
+}
+
+BreathState BreathDetector::update(int32_t value) {
+  int32_t slope = windowCount > 0 ? value - previous : 0;
+  if (windowCount == 0) {
+    restQ = value << BREATH_REST_ALPHA_SHIFT;
+  }
+  previous = value;
+  windowCount++;
+
+  int32_t rise = value - restLevel();
+  switch (current) {
+    case BREATH_WAITING: {
+      // Far enough above rest to stand out of the noise (noise is in 1/16 counts)
+      int32_t threshold = (BREATH_ONSET_NOISE * noise) >> 4;
+      if (threshold < BREATH_ONSET_RISE) {
+        threshold = BREATH_ONSET_RISE;
+      }
+      highWindows = rise >= threshold ? highWindows + 1 : 0;
+      if (highWindows >= BREATH_ONSET_WINDOWS) {
+        current = BREATH_RISING;
+        onset = windowCount - BREATH_ONSET_WINDOWS;
+        flatWindows = 0;
+      } else if (highWindows == 0) {
+        // Slowly follow drift in the resting level (sensor still settling, room air changing),
+        // and learn how noisy the windows are while nothing is happening
+        restQ += value - restLevel();
+        int32_t step = slope < 0 ? -slope : slope;
+        noise += ((step << 4) - noise) >> BREATH_NOISE_ALPHA_SHIFT;
+      }
+      break;
+    }
+    case BREATH_RISING: {
+      // Flat is relative to how far the breath has come, but never finer than the noise
+      int32_t flatSlope = rise * BREATH_PLATEAU_PERCENT / 100;
+      if (flatSlope < (noise >> 4)) {
+        flatSlope = noise >> 4;
+      }
+      flatWindows = slope <= flatSlope ? flatWindows + 1 : 0;
+      if (flatWindows >= BREATH_PLATEAU_WINDOWS && windowCount - onset >= BREATH_MIN_WINDOWS) {
+        current = BREATH_FINISHED;
+        end = windowCount - 1;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+
+  return current;
+}
+
+BreathState BreathDetector::state() const {
+  return current;
+}
+
+bool BreathDetector::started() const {
+  return current != BREATH_WAITING;
+}
+
+bool BreathDetector::finished() const {
+  return current == BREATH_FINISHED;
+}
+
+bool BreathDetector::flat() const {
+  return current != BREATH_WAITING && flatWindows > 0;
+}
+
+int32_t BreathDetector::restLevel() const {
+  return restQ >> BREATH_REST_ALPHA_SHIFT;
+}
+
+uint16_t BreathDetector::windows() const {
+  return windowCount;
+}
+
+uint16_t BreathDetector::onsetWindow() const {
+  return onset;
+}
+
+uint16_t BreathDetector::endWindow() const {
+  return end;
+}
@@ -0,0 +1,64 @@
+#ifndef BREATH_DETECTOR_H
+#define BREATH_DETECTOR_H
+
+#include <stdint.h>
+
+// All in raw ADC counts per filtered window (one window every 200ms by default)
+#define BREATH_ONSET_RISE 15        // Least a breath has to get above the resting level
+#define BREATH_ONSET_NOISE 4        // and at least this many times the window-to-window noise
+#define BREATH_ONSET_WINDOWS 2      // Windows in a row that have to be that high
+#define BREATH_PLATEAU_PERCENT 2    // Climbing by less than this % of the rise per window counts as flat
+#define BREATH_PLATEAU_WINDOWS 3    // Flat windows in a row that end the breath
+#define BREATH_MIN_WINDOWS 5        // Windows after onset before the breath is allowed to end
+#define BREATH_REST_ALPHA_SHIFT 5   // Resting level follows the signal with weight 1/32 while waiting
+#define BREATH_NOISE_ALPHA_SHIFT 3  // Noise estimate weight while waiting, 1/8
+
+enum BreathState
+{
+  BREATH_WAITING = 0,   // Nothing yet, tracking the resting level
+  BREATH_RISING,        // Onset seen, signal still climbing
+  BREATH_FINISHED       // Signal flattened out (or dropped) long enough; the plateau is in
+};
+
+// Online breath onset/end detector on the filtered MQ3 stream. Both thresholds scale with the
+// signal: the onset needs a rise above the resting level that stands clear of the noise for a
+// couple of windows, so small breaths count but noise doesn't, and the end needs the slope to
+// stay under a few percent of the rise (or under the noise, for small ones) for a few windows.
+class BreathDetector
+{
+public:
+  BreathDetector();
+
+  void reset();
+
+  // Feed the next window value. Returns the state after it.
+  BreathState update(int32_t value);
+
+  BreathState state() const;
+  bool started() const;
+  bool finished() const;
+
+  // The newest window counted as flat, i.e. part of the plateau
+  bool flat() const;
+
+  // Resting level the rise is measured from; frozen once the breath starts
+  int32_t restLevel() const;
+
+  // Windows seen so far, and the window the breath started and finished at
+  uint16_t windows() const;
+  uint16_t onsetWindow() const;
+  uint16_t endWindow() const;
+
+private:
+  BreathState current;
+  int32_t restQ;         // Resting level, Q.BREATH_REST_ALPHA_SHIFT
+  int32_t noise;         // Mean |window - previous window|, in 1/16 counts
+  int32_t previous;
+  uint16_t windowCount;
+  uint16_t onset;
+  uint16_t end;
+  uint8_t highWindows;
+  uint8_t flatWindows;
+};
+
+#endif // BREATH_DETECTOR_H
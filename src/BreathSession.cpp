@@ -0,0 +1,139 @@
+#include "BreathSession.h"
+#include "MQ3LookupTable.h"
+
+// Conversions run in fixed point (see MQ3Conversion.h); the Photon has no FPU.
+// The power-law BAC curve comes straight out of a compile-time table (see MQ3LookupTable.h).
+typedef MQ3Lookup<MQ3DefaultProfile> BACLookup;
+
+float calculatePPM(int rawValue) {
+  return MQ3FixedConverter::ppmToFloat(calculatePPMQ(rawValue));
+}
+
+float calculateBAC(int rawValue, int32_t baselinePPM) {
+  return BACLookup::bacToFloat(calculateBACQ(rawValue, baselinePPM));
+}
+
+int32_t calculatePPMQ(int rawValue) {
+  return MQ3FixedConverter::ppm(rawValue);
+}
+
+int32_t calculateBACQ(int rawValue, int32_t baselinePPM) {
+#ifdef LINEAR_BAC_CALC
+  return MQ3FixedConverter::bacLinear(rawValue, baselinePPM);
+#else
+  return BACLookup::bac(rawValue, baselinePPM);
+#endif
+}
+
+BreathSession::BreathSession()
+{
+  reset();
+}
+
+void BreathSession::reset() {
+  filter.reset();
+  detector.reset();
+  fit.reset();
+  allWindows.reset();
+  session.reset();
+  plateau.reset();
+  sketch.reset();
+}
+
+int BreathSession::addSamples(const uint16_t *samples, uint16_t count) {
+  int smallSampleAvg = -1;
+  for (uint16_t i = 0; i < count; i++) {
+    int32_t filtered;
+    if (filter.process(samples[i], filtered)) {
+      smallSampleAvg = filtered;
+      allWindows.add(smallSampleAvg);
+
+      // Only the breath itself counts towards the result; nothing after it has finished
+      if (!detector.finished()) {
+        bool started = detector.started();
+        detector.update(smallSampleAvg);
+        if (detector.started() && !started) {
+          sketch.reset();   // Only the breath from here on, not the clean air before it
+        }
+        sketch.add(smallSampleAvg);
+        if (detector.started()) {
+          session.add(smallSampleAvg);
+          fit.add(smallSampleAvg);
+          if (detector.flat()) {
+            plateau.add(smallSampleAvg);
+          } else {
+            plateau.reset();
+          }
+        }
+      }
+    }
+  }
+
+  return smallSampleAvg;
+}
+
+BreathResult BreathSession::finish(int32_t baselinePPM) const {
+  int maxRaw = maxRawValue();
+  int avgRaw = avgRawValue();
+
+  BreathResult result;
+  result.maxPPM = calculatePPM(maxRaw);
+  result.avgPPM = calculatePPM(avgRaw);
+  result.maxBAC = calculateBAC(maxRaw, baselinePPM);
+  result.avgBAC = calculateBAC(avgRaw, baselinePPM);
+  // PPM is proportional to the raw reading, so the interval scales the same way
+  result.avgPPMConfidence = sessionStats().confidence95() * calculatePPM(MQ3_ADC_MAX) / MQ3_ADC_MAX;
+  result.medianPPM = calculatePPM((int)(percentile(50) + 0.5f));
+  result.breathDetected = detector.started();
+  return result;
+}
+
+int BreathSession::maxRawValue() const {
+  const RunningStats &stats = sessionStats();
+  return stats.count() > 0 ? (int)stats.max() : 0;
+}
+
+int BreathSession::avgRawValue() const {
+  const RunningStats &stats = sessionStats();
+  return stats.count() > 0 ? (int)(stats.mean() + 0.5f) : 0;
+}
+
+uint16_t BreathSession::windowCount() const {
+  return sessionStats().count();
+}
+
+bool BreathSession::breathStarted() const {
+  return detector.started();
+}
+
+bool BreathSession::breathFinished() const {
+  return detector.finished();
+}
+
+const BreathDetector &BreathSession::breathDetector() const {
+  return detector;
+}
+
+int BreathSession::estimateRawValue() const {
+  if (!fit.valid()) {
+    return -1;
+  }
+
+  int32_t estimate = fit.asymptote();
+  if (estimate < 0) {
+    return 0;
+  }
+  return estimate > MQ3_ADC_MAX ? MQ3_ADC_MAX : estimate;
+}
+
+const RunningStats &BreathSession::sessionStats() const {
+  if (detector.finished()) {
+    return plateau;
+  }
+  // If no breath was ever detected, fall back to everything the reading saw
+  return detector.started() ? session : allWindows;
+}
+
+float BreathSession::percentile(float p) const {
+  return sketch.percentile(p);
+}
@@ -0,0 +1,91 @@
+#ifndef BREATH_SESSION_H
+#define BREATH_SESSION_H
+
+#include <stdint.h>
+#include "MQ3Conversion.h"
+#include "StreamingStats.h"
+#include "SampleFilters.h"
+#include "BreathDetector.h"
+#include "ExponentialFit.h"
+
+// #define LINEAR_BAC_CALC
+
+#define SAMPLES_PER_WINDOW 10
+#define SESSION_PERCENTILE_BINS 64   // 128 bytes; percentiles are good to a bin, 64 raw counts
+
+// Filter chain on the raw samples; every value it puts out is one window. Tune noise rejection
+// per enclosure here, e.g. Pipeline<Median3, IIRLowPass<8192>, Decimate<SAMPLES_PER_WINDOW> >.
+// The default is the plain 10-sample average the device has always used.
+typedef Pipeline<Decimate<SAMPLES_PER_WINDOW> > MQ3Filter;
+
+// Conversions from raw MQ3 ADC counts. baselinePPM (Q16.16) is the clean-air level, 0 if there is
+// none yet: the linear BAC model subtracts it, the power-law curve recalibrates R0 from it.
+float calculatePPM(int rawValue);
+float calculateBAC(int rawValue, int32_t baselinePPM);
+
+// The same in fixed point, PPM in Q16.16 and BAC in Q8.24, for display without going through float
+int32_t calculatePPMQ(int rawValue);
+int32_t calculateBACQ(int rawValue, int32_t baselinePPM);
+
+struct BreathResult
+{
+  int maxPPM;
+  int avgPPM;
+  float maxBAC;
+  float avgBAC;
+  float avgPPMConfidence;   // 95% confidence half-width on avgPPM
+  int medianPPM;            // Of the breath since onset, rise included, where avgPPM is the plateau
+  bool breathDetected;      // false if the result is the whole reading because no breath was seen
+};
+
+// Everything a READING does with the samples it gets: run them through MQ3Filter into
+// windows, pick out the breath with BreathDetector, and turn the max/average of its plateau
+// into PPM and BAC.
+// The filter and the session statistics are both single-pass, so nothing is stored per sample.
+// Only depends on the conversion headers, not on Particle.h, so the same code that runs on the
+// device can be compiled for a host and fed recorded or synthetic samples.
+class BreathSession
+{
+public:
+  BreathSession();
+
+  void reset();
+
+  // Fold in a batch of raw samples. Returns the value of the newest window completed by this
+  // batch, or -1 if none was.
+  int addSamples(const uint16_t *samples, uint16_t count);
+
+  BreathResult finish(int32_t baselinePPM) const;
+
+  int maxRawValue() const;
+  int avgRawValue() const;
+  uint16_t windowCount() const;
+
+  // The breath has started / reached its plateau, so the reading can stop early
+  bool breathStarted() const;
+  bool breathFinished() const;
+  const BreathDetector &breathDetector() const;
+
+  // Provisional result: where the breath's rise is heading, in raw counts, fitted to the
+  // windows since onset and refined with every new one. -1 until the fit has something to say.
+  int estimateRawValue() const;
+
+  // The windows the result comes from: the plateau once the breath has finished, everything
+  // since onset if the reading ended before that, and the whole reading if no breath was seen
+  const RunningStats &sessionStats() const;
+
+  // Approximate percentile (0-100), in raw counts, of the breath since onset, or of the whole
+  // reading if no breath was seen
+  float percentile(float p) const;
+
+private:
+  MQ3Filter filter;
+  BreathDetector detector;
+  ExponentialFit fit;
+  RunningStats allWindows;
+  RunningStats session;
+  RunningStats plateau;   // The current run of flat windows
+  PercentileSketch<MQ3_ADC_MAX + 1, SESSION_PERCENTILE_BINS> sketch;   // Same windows as percentile()
+};
+
+#endif // BREATH_SESSION_H
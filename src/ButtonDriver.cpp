@@ -0,0 +1,45 @@
+#include "ButtonDriver.h"
+
+ButtonDriver::ButtonDriver(pin_t pin) :
+  pin(pin), resyncedDrops(0)
+{
+}
+
+void ButtonDriver::begin() {
+  edges.clear();
+  attachInterrupt(pin, &ButtonDriver::onEdge, this, CHANGE);
+}
+
+void ButtonDriver::stop() {
+  detachInterrupt(pin);
+}
+
+bool ButtonDriver::next(ButtonEdge &edge) {
+  if (edges.pop(edge)) {
+    return true;
+  }
+
+  if (resyncedDrops != edges.overflowCount()) {
+    resyncedDrops = edges.overflowCount();
+    edge.time = millis();
+    edge.pressed = level();
+    return true;
+  }
+  return false;
+}
+
+bool ButtonDriver::level() const {
+  return pinReadFast(pin) == HIGH;
+}
+
+uint32_t ButtonDriver::droppedEdges() const {
+  return edges.overflowCount();
+}
+
+// Interrupt context: just note the time and level
+void ButtonDriver::onEdge() {
+  ButtonEdge edge;
+  edge.time = millis();
+  edge.pressed = level();
+  edges.push(edge);
+}
@@ -0,0 +1,43 @@
+#ifndef BUTTON_DRIVER_H
+#define BUTTON_DRIVER_H
+
+#include "Particle.h"
+#include "SampleRingBuffer.h"
+
+#define BUTTON_EDGE_BUFFER_SIZE 16
+
+struct ButtonEdge
+{
+  uint32_t time;    // millis() when the interrupt fired
+  bool pressed;     // Pin level right after the edge
+};
+
+// Catches every change on the button pin in an interrupt and queues it with a timestamp, so
+// nothing has to poll the pin and a short press can't fall between two polls. Edges go to loop()
+// through the same lock-free ring buffer as the MQ3 samples; debouncing is left to the reader
+// (see ButtonGestures.h), which can do it from the timestamps.
+class ButtonDriver
+{
+public:
+  ButtonDriver(pin_t pin);
+
+  // Set the pin mode first
+  void begin();
+  void stop();
+
+  // Next queued edge, oldest first. Call from loop() only. If edges were lost to a full queue,
+  // a made-up edge with the pin's current level follows, so the reader doesn't stay out of step.
+  bool next(ButtonEdge &edge);
+
+  bool level() const;
+  uint32_t droppedEdges() const;
+
+private:
+  void onEdge();
+
+  pin_t pin;
+  SampleRingBuffer<ButtonEdge, BUTTON_EDGE_BUFFER_SIZE> edges;
+  uint32_t resyncedDrops;
+};
+
+#endif // BUTTON_DRIVER_H
@@ -0,0 +1,123 @@
+#include "ButtonGestures.h"
+
+ButtonGestures::ButtonGestures(uint16_t debounceMs, uint16_t doubleClickMs, uint16_t holdMs) :
+  debounceMs(debounceMs), doubleClickMs(doubleClickMs), holdMs(holdMs)
+{
+  reset();
+}
+
+void ButtonGestures::reset() {
+  phase = WAITING;
+  stable = false;
+  raw = false;
+  changing = false;
+  rawSince = 0;
+  changeStart = 0;
+  phaseStart = 0;
+  queueHead = 0;
+  queueCount = 0;
+}
+
+void ButtonGestures::edge(uint32_t timeMs, bool pressed) {
+  advance(timeMs);
+  if (pressed == raw) {
+    return;     // Nothing changed, e.g. an edge too short for the pin read to catch
+  }
+
+  raw = pressed;
+  rawSince = timeMs;
+  if (raw == stable) {
+    changing = false;   // Bounced back before it settled
+  } else if (!changing) {
+    changing = true;
+    changeStart = timeMs;
+  }
+}
+
+void ButtonGestures::update(uint32_t now) {
+  advance(now);
+}
+
+bool ButtonGestures::next(BUTTON_ACTION &action) {
+  if (queueCount == 0) {
+    return false;
+  }
+
+  action = queue[queueHead];
+  queueHead = (queueHead + 1) % BUTTON_GESTURE_QUEUE;
+  queueCount--;
+  return true;
+}
+
+bool ButtonGestures::pressed() const {
+  return stable;
+}
+
+void ButtonGestures::advance(uint32_t time) {
+  // Signed, since an edge timestamped by the interrupt can be newer than the loop's 'time'
+  if (changing && (int32_t)(time - rawSince) >= (int32_t)debounceMs) {
+    // Timers that ran out before the change still count first
+    checkTimers(changeStart);
+    changing = false;
+    settle(raw, changeStart);
+  }
+  checkTimers(time);
+}
+
+void ButtonGestures::checkTimers(uint32_t time) {
+  uint32_t elapsed = time - phaseStart;
+  if ((int32_t)elapsed < 0) {
+    return;
+  }
+
+  if (phase == FIRST_PRESS && elapsed >= holdMs) {
+    phase = HELD;
+    emit(HOLD);
+  } else if (phase == FIRST_RELEASE && elapsed > doubleClickMs) {
+    phase = WAITING;
+    emit(PRESSED);
+  }
+}
+
+void ButtonGestures::settle(bool pressed, uint32_t time) {
+  stable = pressed;
+
+  switch (phase) {
+    case WAITING:
+      if (pressed) {
+        phase = FIRST_PRESS;
+        phaseStart = time;
+      }
+      break;
+    case FIRST_PRESS:
+      if (!pressed) {
+        phase = FIRST_RELEASE;
+        phaseStart = time;
+      }
+      break;
+    case FIRST_RELEASE:
+      if (pressed) {
+        phase = SECOND_PRESS;
+        phaseStart = time;
+        emit(DOUBLE_CLICK);
+      }
+      break;
+    case HELD:
+    case SECOND_PRESS:
+      if (!pressed) {
+        phase = WAITING;
+        phaseStart = time;
+      }
+      break;
+  }
+}
+
+void ButtonGestures::emit(BUTTON_ACTION action) {
+  if (queueCount == BUTTON_GESTURE_QUEUE) {
+    // Nobody has been reading them; the newest gesture matters most
+    queueHead = (queueHead + 1) % BUTTON_GESTURE_QUEUE;
+    queueCount--;
+  }
+  queue[(queueHead + queueCount) % BUTTON_GESTURE_QUEUE] = action;
+  queueCount++;
+}
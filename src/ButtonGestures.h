@@ -0,0 +1,72 @@
+#ifndef BUTTON_GESTURES_H
+#define BUTTON_GESTURES_H
+
+#include <stdint.h>
+
+#define BUTTON_GESTURE_QUEUE 4
+
+enum BUTTON_ACTION
+{
+  UNPRESSED = 0,
+  PRESSED,        // A single click, once it's clear no second click is coming
+  HOLD,           // Still down after the hold time; sent once per press
+  DOUBLE_CLICK
+};
+
+// Turns timestamped button edges into clicks, holds and double clicks. It only ever looks at the
+// edge timestamps and the time passed to update(), never at a clock of its own, so how late the
+// edges are picked up doesn't change the result and it runs the same on a PC.
+//
+// A level counts once it has lasted debounceMs with no further edges, and dates from the first
+// edge that left the old level, so contact bounce neither adds clicks nor shifts the timing.
+class ButtonGestures
+{
+public:
+  ButtonGestures(uint16_t debounceMs, uint16_t doubleClickMs, uint16_t holdMs);
+
+  void reset();
+
+  // Edges have to come in time order
+  void edge(uint32_t timeMs, bool pressed);
+
+  // Let time run up to 'now', for holds and clicks that end without another edge
+  void update(uint32_t now);
+
+  // Next recognised gesture, oldest first. False when there are none.
+  bool next(BUTTON_ACTION &action);
+
+  bool pressed() const;
+
+private:
+  enum Phase
+  {
+    WAITING,          // Up, nothing going on
+    FIRST_PRESS,      // Down for the first time
+    FIRST_RELEASE,    // Up again; a second press now makes a double click
+    HELD,             // Down past the hold time
+    SECOND_PRESS      // Down for the second click; nothing more until it's let go
+  };
+
+  void advance(uint32_t time);
+  void checkTimers(uint32_t time);
+  void settle(bool pressed, uint32_t time);
+  void emit(BUTTON_ACTION action);
+
+  uint16_t debounceMs;
+  uint16_t doubleClickMs;
+  uint16_t holdMs;
+
+  Phase phase;
+  bool stable;            // Debounced level
+  bool raw;               // Level after the most recent edge
+  bool changing;          // raw has left 'stable' and hasn't settled yet
+  uint32_t rawSince;      // Last edge
+  uint32_t changeStart;   // First edge away from 'stable'
+  uint32_t phaseStart;
+
+  BUTTON_ACTION queue[BUTTON_GESTURE_QUEUE];
+  uint8_t queueHead;
+  uint8_t queueCount;
+};
+
+#endif // BUTTON_GESTURES_H
@@ -0,0 +1,19 @@
+#ifndef CRC8_H
+#define CRC8_H
+
+#include <stdint.h>
+
+// CRC-8, polynomial 0x07, initial value 0, no reflection or final XOR. Guards the session log
+// records in EEPROM and the sensor trace frames.
+inline uint8_t crc8(const uint8_t *data, uint16_t length) {
+  uint8_t crc = 0;
+  for (uint16_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+#endif // CRC8_H
@@ -0,0 +1,34 @@
+#include "DeviceModes.h"
+
+const StateDefinition DEVICE_MODE_STATES[NUM_MODES] = {
+  //              enter           exit             update
+  /* WARMING_UP */ { enterWarmingUp, finishWarmingUp, updateWarmingUp },
+  /* IDLE       */ { enterIdle,      NULL,            updateIdle },
+  /* READING    */ { enterReading,   stopModeTimers,  updateReading },
+  /* COOLDOWN   */ { enterCooldown,  stopModeTimers,  NULL },
+};
+
+#define IGNORED { STATE_NONE, NULL, NULL }
+
+const StateTransition DEVICE_MODE_TRANSITIONS[NUM_MODES][NUM_MODE_EVENTS] = {
+  /* WARMING_UP */ {
+    /* BUTTON  */ IGNORED,
+    /* TIMEOUT */ { IDLE, NULL, NULL },             // Gave up waiting for the sensor to settle
+    /* SAMPLES */ { IDLE, warmupSettled, NULL },
+  },
+  /* IDLE */ {
+    /* BUTTON  */ { READING, NULL, NULL },
+    /* TIMEOUT */ IGNORED,
+    /* SAMPLES */ IGNORED,
+  },
+  /* READING */ {
+    /* BUTTON  */ IGNORED,
+    /* TIMEOUT */ { COOLDOWN, NULL, NULL },
+    /* SAMPLES */ { COOLDOWN, breathDone, NULL },   // No need to wait out the rest once the breath levels off
+  },
+  /* COOLDOWN */ {
+    /* BUTTON  */ IGNORED,
+    /* TIMEOUT */ { IDLE, NULL, NULL },             // Results stay on screen until the next reading
+    /* SAMPLES */ IGNORED,
+  },
+};
@@ -0,0 +1,42 @@
+#ifndef DEVICE_MODES_H
+#define DEVICE_MODES_H
+
+#include "StateMachine.h"
+
+enum DEVICE_MODE
+{
+  WARMING_UP  = 0,
+  IDLE,
+  READING,
+  COOLDOWN,
+  NUM_MODES
+};
+
+enum MODE_EVENT
+{
+  MODE_EVENT_BUTTON = 0,  // Button pressed or held
+  MODE_EVENT_TIMEOUT,     // The mode's time ran out
+  MODE_EVENT_SAMPLES,     // A batch of MQ3 samples was processed
+  NUM_MODE_EVENTS
+};
+
+typedef StateMachine<NUM_MODES, NUM_MODE_EVENTS> DeviceModeMachine;
+
+// The mode tables, in DeviceModes.cpp
+extern const StateDefinition DEVICE_MODE_STATES[NUM_MODES];
+extern const StateTransition DEVICE_MODE_TRANSITIONS[NUM_MODES][NUM_MODE_EVENTS];
+
+// Actions and guards the tables refer to, implemented by the application
+void enterWarmingUp();
+void updateWarmingUp();
+void finishWarmingUp();
+bool warmupSettled();
+void enterIdle();
+void updateIdle();
+void enterReading();
+void updateReading();
+bool breathDone();
+void enterCooldown();
+void stopModeTimers();
+
+#endif // DEVICE_MODES_H
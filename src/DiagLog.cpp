@@ -0,0 +1,149 @@
+#include "DiagLog.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const char LEVEL_LETTERS[] = "EWID";
+
+DiagLog diag;
+
+DiagLog::DiagLog() :
+  clock(NULL), head(0), count(0), droppedCount(0), dropsToReport(0), lineLength(0)
+{
+}
+
+void DiagLog::begin(DiagClock clock) {
+  this->clock = clock;
+}
+
+void DiagLog::write(uint8_t level, const char *format, const DiagArg *args, uint8_t argCount) {
+  if (count == DIAG_RING_ENTRIES) {
+    Entry &newest = entries[(head + count - 1) % DIAG_RING_ENTRIES];
+    if (newest.dropsAfter < UINT16_MAX) {
+      newest.dropsAfter++;
+    }
+    droppedCount++;
+    return;
+  }
+
+  Entry &entry = entries[(head + count) % DIAG_RING_ENTRIES];
+  entry.time = clock ? clock() : 0;
+  entry.format = format;
+  entry.level = level;
+  entry.argCount = argCount;
+  entry.dropsAfter = 0;
+  for (uint8_t i = 0; i < argCount; i++) {
+    entry.types[i] = args[i].type;
+    entry.values[i] = args[i].v;
+  }
+  count++;
+}
+
+uint8_t DiagLog::drain(DiagSink sink, size_t budget) {
+  uint8_t sent = 0;
+
+  while (true) {
+    if (lineLength == 0) {
+      if (dropsToReport > 0) {
+        int n = snprintf(line, sizeof(line), "[log] %u messages dropped\r\n", dropsToReport);
+        lineLength = n > 0 && (size_t)n < sizeof(line) ? n : sizeof(line) - 1;
+        dropsToReport = 0;
+      } else if (count > 0) {
+        lineLength = formatEntry(entries[head]);
+        dropsToReport = entries[head].dropsAfter;
+        head = (head + 1) % DIAG_RING_ENTRIES;
+        count--;
+      } else {
+        break;
+      }
+    }
+
+    // Keep the formatted line for next time rather than block on a full output buffer
+    if (lineLength > budget) {
+      break;
+    }
+
+    sink(line, lineLength);
+    budget -= lineLength;
+    lineLength = 0;
+    sent++;
+  }
+
+  return sent;
+}
+
+uint8_t DiagLog::pending() const {
+  return count + (lineLength > 0 ? 1 : 0) + (dropsToReport > 0 ? 1 : 0);
+}
+
+uint32_t DiagLog::dropped() const {
+  return droppedCount;
+}
+
+// Runs the stored format through snprintf one conversion at a time, so each captured argument
+// is passed back with the C type its conversion expects
+size_t DiagLog::formatEntry(const Entry &entry) {
+  // Leave room for the line ending
+  const size_t size = sizeof(line) - 2;
+  int used = snprintf(line, size, "[%7lu.%03lu] %c ", (unsigned long)(entry.time / 1000),
+                      (unsigned long)(entry.time % 1000), LEVEL_LETTERS[entry.level & 3]);
+
+  const char *p = entry.format;
+  uint8_t arg = 0;
+  while (*p && used >= 0 && (size_t)used < size - 1) {
+    if (*p != '%') {
+      line[used++] = *p++;
+      continue;
+    }
+
+    // Copy one conversion spec, e.g. "%-6.2f", and find its conversion character
+    char spec[12];
+    uint8_t length = 0;
+    spec[length++] = *p++;
+    while (*p && strchr("-+ #0123456789.l", *p) && length < sizeof(spec) - 2) {
+      spec[length++] = *p++;
+    }
+    char conversion = *p ? *p++ : '\0';
+    spec[length++] = conversion;
+    spec[length] = '\0';
+
+    int n;
+    if (conversion == '%') {
+      n = snprintf(line + used, size - used, "%%");
+    } else if (arg >= entry.argCount) {
+      n = snprintf(line + used, size - used, "?");
+    } else {
+      const DiagValue &value = entry.values[arg];
+      uint8_t type = entry.types[arg];
+      arg++;
+
+      if (type == DIAG_ARG_FLOAT) {
+        n = snprintf(line + used, size - used, strchr("eEfgG", conversion) ? spec : "%g", (double)value.f);
+      } else if (type == DIAG_ARG_STRING) {
+        n = snprintf(line + used, size - used, conversion == 's' ? spec : "%s", value.s ? value.s : "(null)");
+      } else if (strchr("diuxXoc", conversion) && spec[length - 2] != 'l') {
+        n = snprintf(line + used, size - used, spec, type == DIAG_ARG_INT ? (int)value.i : (int)value.u);
+      } else if (type == DIAG_ARG_INT) {
+        n = snprintf(line + used, size - used, "%ld", (long)value.i);
+      } else {
+        n = snprintf(line + used, size - used, "%lu", (unsigned long)value.u);
+      }
+    }
+
+    if (n < 0) {
+      break;
+    }
+    used += n;
+  }
+
+  if (used < 0) {
+    used = 0;
+  }
+  if ((size_t)used > size - 1) {
+    used = size - 1;
+  }
+  line[used++] = '\r';
+  line[used++] = '\n';
+  line[used] = '\0';
+  return used;
+}
@@ -0,0 +1,139 @@
+#ifndef DIAG_LOG_H
+#define DIAG_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Named DIAG_* rather than LOG_* so it stays clear of Device OS's own logging macros
+#define DIAG_LEVEL_ERROR 0
+#define DIAG_LEVEL_WARN 1
+#define DIAG_LEVEL_INFO 2
+#define DIAG_LEVEL_DEBUG 3
+
+// Messages above this level are compiled out entirely
+#ifndef DIAG_LEVEL
+#define DIAG_LEVEL DIAG_LEVEL_INFO
+#endif
+
+#define DIAG_RING_ENTRIES 32
+#define DIAG_MAX_ARGS 4
+#define DIAG_LINE_LENGTH 96
+
+enum DiagArgType
+{
+  DIAG_ARG_INT = 0,
+  DIAG_ARG_UINT,
+  DIAG_ARG_FLOAT,
+  DIAG_ARG_STRING
+};
+
+union DiagValue
+{
+  int32_t i;
+  uint32_t u;
+  float f;
+  const char *s;
+};
+
+// One printf argument, captured by value when the message is logged
+struct DiagArg
+{
+  DiagArg(int value) : type(DIAG_ARG_INT) { v.i = value; }
+  DiagArg(long value) : type(DIAG_ARG_INT) { v.i = value; }
+  DiagArg(unsigned int value) : type(DIAG_ARG_UINT) { v.u = value; }
+  DiagArg(unsigned long value) : type(DIAG_ARG_UINT) { v.u = value; }
+  DiagArg(float value) : type(DIAG_ARG_FLOAT) { v.f = value; }
+  DiagArg(double value) : type(DIAG_ARG_FLOAT) { v.f = value; }
+  DiagArg(const char *value) : type(DIAG_ARG_STRING) { v.s = value; }
+
+  uint8_t type;
+  DiagValue v;
+};
+
+typedef uint32_t (*DiagClock)();
+typedef void (*DiagSink)(const char *line, size_t length);
+
+// Logging that never blocks the caller. log() only copies the format pointer and the raw
+// argument values into a fixed ring; the text is produced later by drain(), which only writes
+// as many lines as the output can take right now. When the ring is full new messages are
+// dropped and counted, and the count shows up in the output where the messages went missing.
+//
+// The format and any %s arguments are kept by pointer, so they must be string literals (or
+// otherwise outlive the message). Call log() and drain() from loop() context only.
+class DiagLog
+{
+public:
+  DiagLog();
+
+  void begin(DiagClock clock);
+
+  void log(uint8_t level, const char *format) {
+    write(level, format, NULL, 0);
+  }
+
+  template <typename... ARGS>
+  void log(uint8_t level, const char *format, ARGS... args) {
+    static_assert(sizeof...(ARGS) <= DIAG_MAX_ARGS, "Too many log arguments");
+    const DiagArg list[] = { DiagArg(args)... };
+    write(level, format, list, sizeof...(ARGS));
+  }
+
+  // Format and hand queued lines to the sink while they fit in 'budget' bytes.
+  // Returns how many lines went out.
+  uint8_t drain(DiagSink sink, size_t budget);
+
+  uint8_t pending() const;
+  uint32_t dropped() const;
+
+private:
+  struct Entry
+  {
+    uint32_t time;
+    const char *format;
+    uint8_t level;
+    uint8_t argCount;
+    uint16_t dropsAfter;  // Messages dropped right after this one because the ring was full
+    uint8_t types[DIAG_MAX_ARGS];
+    DiagValue values[DIAG_MAX_ARGS];
+  };
+
+  void write(uint8_t level, const char *format, const DiagArg *args, uint8_t argCount);
+  size_t formatEntry(const Entry &entry);
+
+  DiagClock clock;
+  Entry entries[DIAG_RING_ENTRIES];
+  uint8_t head;
+  uint8_t count;
+  uint32_t droppedCount;
+  uint16_t dropsToReport;
+  char line[DIAG_LINE_LENGTH];
+  size_t lineLength;    // A line formatted but not yet sent, or 0
+};
+
+extern DiagLog diag;
+
+#if DIAG_LEVEL >= DIAG_LEVEL_ERROR
+#define DIAG_ERROR(...) diag.log(DIAG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define DIAG_ERROR(...) do {} while (0)
+#endif
+
+#if DIAG_LEVEL >= DIAG_LEVEL_WARN
+#define DIAG_WARN(...) diag.log(DIAG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define DIAG_WARN(...) do {} while (0)
+#endif
+
+#if DIAG_LEVEL >= DIAG_LEVEL_INFO
+#define DIAG_INFO(...) diag.log(DIAG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define DIAG_INFO(...) do {} while (0)
+#endif
+
+#if DIAG_LEVEL >= DIAG_LEVEL_DEBUG
+#define DIAG_DEBUG(...) diag.log(DIAG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define DIAG_DEBUG(...) do {} while (0)
+#endif
+
+#endif // DIAG_LOG_H
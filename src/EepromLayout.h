@@ -0,0 +1,46 @@
+#ifndef EEPROM_LAYOUT_H
+#define EEPROM_LAYOUT_H
+
+#include <stdint.h>
+
+// Where each persisted record lives in the Photon's emulated EEPROM (2047 bytes).
+// Every record starts with its own magic number, so a blank or reformatted EEPROM
+// (all 0xFF) simply reads back as "nothing stored".
+
+#define EEPROM_BASELINE_ADDRESS 0
+#define BASELINE_RECORD_MAGIC 0xB1A5
+
+struct BaselineRecord
+{
+  uint16_t magic;
+  uint16_t reserved;
+  int32_t rawQ;         // BaselineTracker::rawQ()
+  uint32_t check;       // ~rawQ, catches a record that was only partly written
+};
+
+// Session history: a circular log of fixed-size slots after the baseline record (see
+// SessionLog.h). Slots don't carry a magic; a slot only counts once its commit byte holds
+// SESSION_COMMIT_MARKER, which is written last.
+#define EEPROM_SIZE 2047
+#define EEPROM_SESSION_LOG_ADDRESS 16
+#define SESSION_LOG_SLOTS 96
+#define SESSION_COMMIT_MARKER 0x5A
+
+struct SessionLogRecord
+{
+  uint32_t sequence;    // Counts up from 1 across the whole life of the log
+  uint32_t timestamp;   // Unix time, 0 if the clock wasn't synced yet
+  uint16_t maxPPM;
+  uint16_t avgPPM;
+  uint16_t maxBAC;      // In millionths, as in PublishRecord
+  uint16_t avgBAC;
+  uint16_t duration;    // Tenths of a second
+  uint8_t crc;          // Over everything above
+  uint8_t commit;
+};
+
+static_assert(sizeof(BaselineRecord) <= EEPROM_SESSION_LOG_ADDRESS - EEPROM_BASELINE_ADDRESS, "baseline record overlaps the session log");
+static_assert(sizeof(SessionLogRecord) == 20, "session log slots must not contain padding");
+static_assert(EEPROM_SESSION_LOG_ADDRESS + SESSION_LOG_SLOTS * sizeof(SessionLogRecord) <= EEPROM_SIZE, "session log doesn't fit in EEPROM");
+
+#endif // EEPROM_LAYOUT_H
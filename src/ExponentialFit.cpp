@@ -0,0 +1,74 @@
+#include "ExponentialFit.h"
+
+ExponentialFit::ExponentialFit()
+{
+  reset();
+}
+
+void ExponentialFit::reset() {
+  previous = 0;
+  count = 0;
+  sumX = 0;
+  sumY = 0;
+  sumXX = 0;
+  sumXY = 0;
+  a = 0;
+  b = 0;
+  isValid = false;
+}
+
+void ExponentialFit::add(int32_t value) {
+  if (count > 0) {
+    // One (x, y) pair per step: x is the previous value, y the new one
+    sumX += previous;
+    sumY += value;
+    sumXX += (int64_t)previous * previous;
+    sumXY += (int64_t)previous * value;
+  }
+  previous = value;
+  count++;
+
+  solve();
+}
+
+void ExponentialFit::solve() {
+  isValid = false;
+  if (count < FIT_MIN_POINTS) {
+    return;
+  }
+
+  int64_t pairs = count - 1;
+  int64_t denominator = pairs * sumXX - sumX * sumX;
+  if (denominator <= 0) {
+    // Every x the same, i.e. a flat line so far
+    return;
+  }
+
+  a = (float)(pairs * sumXY - sumX * sumY) / denominator;
+  b = (sumY - a * sumX) / pairs;
+
+  // 0 < a < 1 is a rise (or fall) that is settling. a >= 1 means it is still speeding up or
+  // just a straight ramp, which has no asymptote yet.
+  isValid = a > 0 && a < FIT_MAX_DECAY;
+}
+
+bool ExponentialFit::valid() const {
+  return isValid;
+}
+
+int32_t ExponentialFit::asymptote() const {
+  if (!isValid) {
+    return previous;
+  }
+
+  float target = b / (1 - a);
+  return (int32_t)(target < 0 ? target - 0.5f : target + 0.5f);
+}
+
+float ExponentialFit::decay() const {
+  return a;
+}
+
+uint16_t ExponentialFit::points() const {
+  return count;
+}
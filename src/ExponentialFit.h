@@ -0,0 +1,47 @@
+#ifndef EXPONENTIAL_FIT_H
+#define EXPONENTIAL_FIT_H
+
+#include <stdint.h>
+
+#define FIT_MIN_POINTS 4        // Values needed before there is any estimate at all
+#define FIT_MAX_DECAY 0.98f     // Slower than this per step and the extrapolation is mostly noise
+
+// Incremental fit of a first-order step response, y(t) = A - (A - y0) * e^(-t / tau), to equally
+// spaced values. Sampled, that is y[n+1] = a * y[n] + b with a = e^(-T / tau), so a straight-line
+// least-squares fit of each value against the one before it gives a and b, and the value the
+// signal is heading for is A = b / (1 - a). Only the five running sums are kept, in 64-bit
+// integers so they stay exact for 12-bit ADC values; each update is a handful of adds.
+class ExponentialFit
+{
+public:
+  ExponentialFit();
+
+  void reset();
+  void add(int32_t value);
+
+  // True once there are enough points and they look like a rise that is levelling off
+  bool valid() const;
+
+  // Predicted final value. Falls back to the newest value while the fit isn't valid.
+  int32_t asymptote() const;
+
+  // Per-step decay factor a; tau = -T / ln(a)
+  float decay() const;
+
+  uint16_t points() const;
+
+private:
+  void solve();
+
+  int32_t previous;
+  uint16_t count;
+  int64_t sumX;
+  int64_t sumY;
+  int64_t sumXX;
+  int64_t sumXY;
+  float a;
+  float b;
+  bool isValid;
+};
+
+#endif // EXPONENTIAL_FIT_H
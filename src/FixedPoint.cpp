@@ -0,0 +1,28 @@
+#include "FixedPoint.h"
+
+const uint32_t FIXED_EXP2_FRACTION_Q30[24] = {
+  0x5A82799A, // 2^(2^-1)
+  0x4C1BF829, // 2^(2^-2)
+  0x45CAE0F2, // 2^(2^-3)
+  0x42D561B4, // 2^(2^-4)
+  0x4166C34C, // 2^(2^-5)
+  0x40B268FA, // 2^(2^-6)
+  0x4058F6A8, // 2^(2^-7)
+  0x402C6BE9, // 2^(2^-8)
+  0x4016321B, // 2^(2^-9)
+  0x400B1818, // 2^(2^-10)
+  0x40058BCE, // 2^(2^-11)
+  0x4002C5D8, // 2^(2^-12)
+  0x400162E8, // 2^(2^-13)
+  0x4000B173, // 2^(2^-14)
+  0x400058B9, // 2^(2^-15)
+  0x40002C5D, // 2^(2^-16)
+  0x4000162E, // 2^(2^-17)
+  0x40000B17, // 2^(2^-18)
+  0x4000058C, // 2^(2^-19)
+  0x400002C6, // 2^(2^-20)
+  0x40000163, // 2^(2^-21)
+  0x400000B1, // 2^(2^-22)
+  0x40000059, // 2^(2^-23)
+  0x4000002C  // 2^(2^-24)
+};
@@ -0,0 +1,80 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+
+// 2^(2^-k) in Q30 for k = 1..24, used by QFormat::exp2()
+extern const uint32_t FIXED_EXP2_FRACTION_Q30[24];
+
+// Signed fixed-point math on a Qm.FRAC_BITS value stored in an int32_t.
+// The Photon's Cortex-M3 has no FPU, so everything here sticks to integer multiplies and shifts.
+template <uint8_t FRAC_BITS>
+struct QFormat
+{
+  static_assert(FRAC_BITS >= 8 && FRAC_BITS <= 24, "FRAC_BITS must be between 8 and 24");
+
+  static const int32_t ONE = (int32_t)1 << FRAC_BITS;
+
+  static constexpr int32_t fromDouble(double value) {
+    return (int32_t)(value * ONE + (value >= 0 ? 0.5 : -0.5));
+  }
+
+  static int32_t fromInt(int32_t value) {
+    return value * ONE;
+  }
+
+  // Only meant for display/debug output, never for the conversion path itself
+  static float toFloat(int32_t q) {
+    return q * (1.0f / ONE);
+  }
+
+  static int32_t mul(int32_t a, int32_t b) {
+    return (int32_t)(((int64_t)a * b) >> FRAC_BITS);
+  }
+
+  // log2 of a positive integer. Error is below one LSB.
+  static int32_t log2(uint32_t value) {
+    int32_t msb = 31 - __builtin_clz(value);
+    int32_t result = msb * ONE;
+
+    // Normalise the mantissa to [1, 2) in Q30, then pull out one fraction bit per squaring
+    uint32_t mantissa = msb > 30 ? value >> 1 : value << (30 - msb);
+    for (int32_t bit = ONE >> 1; bit != 0; bit >>= 1) {
+      mantissa = (uint32_t)(((uint64_t)mantissa * mantissa) >> 30);
+      if (mantissa >= (2u << 30)) {
+        mantissa >>= 1;
+        result += bit;
+      }
+    }
+
+    return result;
+  }
+
+  // 2^q, saturating at INT32_MAX and flushing to zero below one LSB. Relative error is about 2^-FRAC_BITS.
+  static int32_t exp2(int32_t q) {
+    int32_t whole = q >> FRAC_BITS;
+    uint32_t fraction = (uint32_t)q & (ONE - 1);
+
+    uint32_t mantissa = 1u << 30;
+    for (uint8_t k = 1; k <= FRAC_BITS; k++) {
+      if (fraction & (1u << (FRAC_BITS - k))) {
+        mantissa = (uint32_t)(((uint64_t)mantissa * FIXED_EXP2_FRACTION_Q30[k - 1]) >> 30);
+      }
+    }
+
+    int32_t shift = 30 - FRAC_BITS - whole;
+    if (shift < 0) {
+      return INT32_MAX;
+    } else if (shift == 0) {
+      return (int32_t)mantissa;
+    } else if (shift >= 32) {
+      return 0;
+    }
+
+    return (int32_t)((mantissa + (1u << (shift - 1))) >> shift);
+  }
+};
+
+typedef QFormat<16> Q16;
+
+#endif // FIXED_POINT_H
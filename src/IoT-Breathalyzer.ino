@@ -2,15 +2,23 @@
 #include "Grove_LCD_RGB_Backlight.h"
 #include "Particle.h"
 #include "neopixel.h"
-
-enum DEVICE_MODE
-{
-  WARMING_UP  = 0,
-  IDLE,
-  READING,
-  NUM_MODES,
-  COOLDOWN
-};
+#include "MQ3Sampler.h"
+#include "ButtonDriver.h"
+#include "ButtonGestures.h"
+#include "LcdFramebuffer.h"
+#include "MQ3Conversion.h"
+#include "NumberFormat.h"
+#include "BreathSession.h"
+#include "SensorTrace.h"
+#include "BaselineTracker.h"
+#include "EepromLayout.h"
+#include "WarmupMonitor.h"
+#include "Profiler.h"
+#include "DiagLog.h"
+#include "PublishQueue.h"
+#include "SessionLog.h"
+#include "TaskScheduler.h"
+#include "DeviceModes.h"
 
 enum DISPLAY_MODE
 {
@@ -18,31 +26,34 @@ enum DISPLAY_MODE
   BAC
 };
 
-enum BUTTON_ACTION
-{
-  UNPRESSED = 0,
-  PRESSED,
-  HOLD,
-  DOUBLE_CLICK
-};
-
-// #define LINEAR_BAC_CALC
-
 #define MAX_ROW 0
 #define AVG_ROW 1
 
 #define SENSOR_READ_TIME_DIFFERENCE 2000
 #define WARMING_UP_LED_TIME_DIFFERENCE 500
 #define READING_LED_TIME_DIFFERENCE 200
-#define WARMING_UP_MODE_TIME 5000
-#define READING_MODE_TIME 10000
+#define WARMING_UP_MAX_TIME 60000     // Longest warm-up can take; it normally ends once the sensor settles
+#define READING_MODE_TIME 10000      // Longest a reading can take; it normally ends once the breath levels off
 #define COOLDOWN_TIME 10000
 #define MS_BETWEEN_SAMPLES 20
-#define DEBOUNCE_TIME 50
-#define DOUBLE_CLICK_WAIT_TIME 500
+#define SAMPLE_BATCH_SIZE 16
+#define DEBOUNCE_TIME 20
+#define DOUBLE_CLICK_WAIT_TIME 300  // Longest gap between the clicks of a double click, and how long a single click waits to be sure
+#define HOLD_TIME 500
 #define RECENT_FINISH_HOLD_LED_TIME_MS 10000
 #define UPLOAD_PERIOD 1000
-#define SOLID 0
+#define BUTTON_POLL_PERIOD 20        // Just picks up queued edges; the interrupt has their exact times
+#define SAMPLE_TASK_PERIOD 50
+#define COUNTDOWN_PERIOD 1000
+#define HISTORY_PUBLISH_PERIOD 1500 // Spaced out to stay under the cloud's one event per second
+#define PUBLISH_FLUSH_PERIOD 10000  // Results are batched; one event per flush stays well under the cloud rate limit
+#define PUBLISH_CHECK_PERIOD 1000   // How soon to look at a send again, and then maybe send the next one
+#define SERIAL_POLL_PERIOD 50
+#define LOG_DRAIN_PERIOD 20
+#define SUMMARY_PERIOD 5000         // How often the "profile" and "health" variables are refreshed
+#define COMMAND_LINE_LENGTH 32
+#define BASELINE_SAVE_PERIOD 600000   // Emulated EEPROM wears, so only write the baseline every 10 minutes
+#define BASELINE_SAVE_DELTA (2 << BASELINE_FRAC_BITS) // and only if it moved by at least 2 counts
 
 #define HIGH_PPM 15000
 #define MEDIUM_PPM 10000
@@ -53,55 +64,125 @@ enum BUTTON_ACTION
 #define OFF 0
 
 //Pins
-#define PIXEL_PIN D3
+#define PIXEL_PIN D3    // Not a MOSI pin, so the strip is bit-banged rather than on setOutputSPI()
 #define BUTTON_PIN D2
 #define MQ3_PIN A1
 
 rgb_lcd lcd;
+LcdFramebuffer display(lcd);
 Adafruit_NeoPixel strip = Adafruit_NeoPixel(PIXEL_COUNT, PIXEL_PIN, PIXEL_TYPE);
+MQ3Sampler sampler(MQ3_PIN, MS_BETWEEN_SAMPLES);
+ButtonDriver button(BUTTON_PIN);
+ButtonGestures gestures(DEBOUNCE_TIME, DOUBLE_CLICK_WAIT_TIME, HOLD_TIME);
 
-DEVICE_MODE deviceMode = WARMING_UP;
 DISPLAY_MODE displayMode = PPM;
-BUTTON_ACTION buttonState = UNPRESSED;
+TaskScheduler scheduler;
+BreathSession session;
+BaselineTracker baseline;
+WarmupMonitor warmup;
+
+// WARMING_UP -> IDLE <-> READING -> COOLDOWN -> IDLE; the transitions are in DeviceModes.cpp
+void logModeChange(uint8_t from, uint8_t event, uint8_t to);
+DeviceModeMachine modes(DEVICE_MODE_STATES, DEVICE_MODE_TRANSITIONS, logModeChange);
+
+void writeTrace(const uint8_t *data, uint16_t length);
+TraceRecorder trace(writeTrace);
+
+// Results waiting for the cloud. Kept in backup RAM so they survive a reset while offline.
+STARTUP(System.enableFeature(FEATURE_RETAINED_MEMORY));
+retained PublishStore publishStore;
+PublishQueue publishQueue(publishStore);
+particle::Future<bool> resultsSend;   // The event publishQueue has in flight
+
+// Every result also goes into a log in EEPROM that can be read back later
+void readEeprom(uint16_t address, uint8_t *data, uint16_t length);
+void writeEeprom(uint16_t address, const uint8_t *data, uint16_t length);
+SessionLog sessionLog(readEeprom, writeEeprom);
+
+// A history request streams out of the log through its own queue, in the same format
+PublishStore historyStore;
+PublishQueue historyQueue(historyStore);
+particle::Future<bool> historySend;
 
 // Time Variables
 unsigned long int currentTime = 0;
-unsigned long int nextSensorReadTime = 0;
-unsigned long int lastSensorReadTime = 0;
-unsigned long int buttonHoldBeginTime = 0;
-unsigned long int debounceEndWaitTime = 0;
-unsigned long int nextLedFlashTime = 0;
-unsigned long int stateChangeTime = 0;
-unsigned long int readingLastCalled = 0;
-unsigned long int cooldownLastCalled = 0;
+unsigned long int warmupStartTime = 0;
+unsigned long int readingStartTime = 0;
+uint32_t historySequence = 0;   // Next logged result to send for a history request
+uint32_t historyFrom = 0;
+uint32_t historyTo = 0;
 
 const int displayBacklightR = 255;
 const int displayBacklightG = 0;
 const int displayBacklightB = 0;
 int intensity = 100;
 int ledFlashOn = 0;
-int lastButtonReading = LOW;
-int maxRawValue = 0;
+int ledFlashColor = 0;
 int maxPPM = 0;
 int avgPPM = 0;
-int smallSampleCount = 0;
-int fullSampleCount = 0;
-int countdown1 = 0;
-int countdown2 = 0;
+int countdown = 0;
+int warmupTimeMs = 0;
+char commandLine[COMMAND_LINE_LENGTH];
+uint8_t commandLength = 0;
+char profileSummary[256] = "";
+char health[128] = "";
+uint32_t reportedLosses = 0;    // Deadline misses and dropped samples, edges and LCD writes already logged
+uint16_t sampleBatch[SAMPLE_BATCH_SIZE];
+uint16_t sampleBatchCount = 0;
 float maxBAC = 0;
 float avgBAC = 0;
-float smallSampleTotal = 0;
-float fullSampleTotal = 0;
 float ppm = 0;
-float baseLinePPM = 0;
-bool watchingButton = false;
+int32_t baseLinePPM = 0; // Q16.16
+int32_t savedBaselineQ = 0;
+bool resultsShown = false;
 bool recentlyFinished = false;
 
-float calculatePPM(float rawValue);
+// Tasks
+TaskId buttonTask;
+TaskId sampleTask;
+TaskId ledTask;
+TaskId countdownTask;
+TaskId modeTimeoutTask;
+TaskId publishTask;
+TaskId baselineSaveTask;
+TaskId serialTask;
+TaskId logTask;
+TaskId summaryTask;
+TaskId historyTask;
+
 void updateDisplay();
-void handleLED(int timeDifference, int color);
-BUTTON_ACTION checkButton(int buttonReading);
-float calculateBAC(float ppm);
+void showCountdown();
+void flashLED(int timeDifference, int color);
+void setLED(int color);
+void handleButton(BUTTON_ACTION action);
+void toggleDisplayMode();
+
+void pollButton();
+void processSamples();
+void toggleLED();
+void tickCountdown();
+void endMode();
+bool settleSend(PublishQueue &queue, const particle::Future<bool> &send, const char *name);
+void publishResults();
+bool publishBatch(const char *payload);
+uint16_t bacMillionths(float bac);
+void logResult(const PublishRecord &record);
+void printSession(const SessionLogRecord &record);
+void publishHistory();
+bool publishHistoryBatch(const char *payload);
+void saveBaseline();
+bool loadBaseline();
+void pollSerial();
+void drainLog();
+void writeLogLine(const char *line, size_t length);
+uint32_t logClock();
+void handleCommand(const char *command);
+void printTaskStats(const char *name, TaskId id);
+void updateSummaries();
+void updateHealth();
+
+int setTrace(String command);
+int requestHistory(String command);
 
 int PixelColorRed = strip.Color(0, intensity, 0);
 int PixelColorGreen  = strip.Color(intensity,  0,  0);
@@ -110,296 +191,675 @@ int PixelColorOff = strip.Color(  0,  0,  0);
 
 void setup() {
   Serial.begin(9600);     // Initialize Serial communication
+  diag.begin(logClock);   // Log lines are queued and go out from drainLog() as Serial has room
 
   pinMode(BUTTON_PIN, INPUT_PULLDOWN); // Setup button input
+  button.begin();
   strip.begin(); // Begin LED management
 
-  // LCD Setup:
-  lcd.begin(16, 2);
+  // LCD Setup: never let the display block the loop, queued bytes go out from lcd.update()
+  lcd.setAsync(true);
+  lcd.begin(LCD_COLS, LCD_ROWS);
   lcd.setRGB(displayBacklightR, displayBacklightG, displayBacklightB);
-  lcd.setCursor(0, 0);
-  lcd.print("WARMING UP...");
-
-  deviceMode = WARMING_UP;
-  stateChangeTime = millis() + WARMING_UP_MODE_TIME;
 
   // Declare cloud virables
   Particle.variable("avgPPM", avgPPM); //cloud variable declaration of average PPM value
   Particle.variable("maxPPM", maxPPM);
+  Particle.variable("warmupMs", warmupTimeMs);
+  Particle.variable("profile", profileSummary);
+  Particle.variable("health", health);
+  Particle.function("trace", setTrace);
+  Particle.function("history", requestHistory);
+
+  // Get baseline of PPM. Prefer the one tracked during the last run, since the heater is
+  // still cold here and a single reading now says little about clean air.
+  if (loadBaseline()) {
+    baseLinePPM = baseline.ppm();
+  } else {
+    baseLinePPM = MQ3FixedConverter::ppm(analogRead(MQ3_PIN));
+  }
 
-  // Get baseline of PPM
-  baseLinePPM = calculatePPM(analogRead(MQ3_PIN));
-
-  // Wait a bit
+  // Everything loop() used to poll for is a task now; modes start and stop the ones they need
+  buttonTask = scheduler.add(pollButton, BUTTON_POLL_PERIOD);
+  sampleTask = scheduler.add(processSamples, SAMPLE_TASK_PERIOD);
+  ledTask = scheduler.add(toggleLED, READING_LED_TIME_DIFFERENCE);
+  countdownTask = scheduler.add(tickCountdown, COUNTDOWN_PERIOD);
+  modeTimeoutTask = scheduler.add(endMode, 0);
+  publishTask = scheduler.add(publishResults, PUBLISH_FLUSH_PERIOD);
+  baselineSaveTask = scheduler.add(saveBaseline, BASELINE_SAVE_PERIOD);
+  serialTask = scheduler.add(pollSerial, SERIAL_POLL_PERIOD);
+  logTask = scheduler.add(drainLog, LOG_DRAIN_PERIOD);
+  summaryTask = scheduler.add(updateSummaries, SUMMARY_PERIOD);
+  historyTask = scheduler.add(publishHistory, HISTORY_PUBLISH_PERIOD);
+
+  publishQueue.begin();
+  historyQueue.begin();
+  DIAG_INFO("%d results in the session log", (int)sessionLog.begin());
+
+  // Wait a bit, before anything is scheduled so it doesn't start out late
   delay(100);
+
+  currentTime = millis();
+  scheduler.start(buttonTask, 0, currentTime);
+  scheduler.start(publishTask, PUBLISH_FLUSH_PERIOD, currentTime);
+  scheduler.start(sampleTask, SAMPLE_TASK_PERIOD, currentTime);
+  scheduler.start(baselineSaveTask, BASELINE_SAVE_PERIOD, currentTime);
+  scheduler.start(serialTask, SERIAL_POLL_PERIOD, currentTime);
+  scheduler.start(logTask, LOG_DRAIN_PERIOD, currentTime);
+  scheduler.start(summaryTask, SUMMARY_PERIOD, currentTime);
+
+  // Start sampling the MQ3 in the background
+  sampler.begin();
+
+  modes.start(WARMING_UP);
 }
 
 void loop() {
+  PROFILE_SCOPE("loop");
   currentTime = millis();  // Get the current time and use it when we don't want the tick to change while we're just processing things
 
-  // Check the button
-  buttonState = checkButton(digitalRead(BUTTON_PIN));
-
-  // Device mode state machine
-  switch (deviceMode) {
-    case WARMING_UP: {
-      // Wait, flash the led red, and count down how long we have to wait while warming up the mq3 sensor
-      static unsigned long int readingLastCalled = millis();
-      static int countdown = WARMING_UP_MODE_TIME / 1000;
-      if(currentTime > stateChangeTime) {
-        deviceMode = IDLE;
-        lcd.clear();
-        lcd.setCursor(0, 0);
-        lcd.print("READY...");
-      }  
-
-      if(currentTime > nextLedFlashTime) {
-        ledFlashOn = !ledFlashOn;
-        nextLedFlashTime += WARMING_UP_LED_TIME_DIFFERENCE;
-      }  
-      Serial.print(ledFlashOn);
-
-      if (millis() - readingLastCalled > 1000) {
-        lcd.setCursor(14, 0);
-        if(countdown <= 9) {
-          lcd.print(0);
-          lcd.setCursor(15, 0);
-        }
-
-        lcd.print(--countdown);
-        readingLastCalled = millis();
-      }
+  scheduler.run(currentTime);
 
-      handleLED(WARMING_UP_LED_TIME_DIFFERENCE, PixelColorRed);
-      } break;
-    case IDLE:
-      // Mode when nothing is happening and we're just waiting for a button press
-      if (buttonState == PRESSED || buttonState == HOLD) {
-        deviceMode = READING;
-        stateChangeTime = millis() + READING_MODE_TIME;
-        readingLastCalled = millis();
-        countdown1 = READING_MODE_TIME / 1000;
-        lcd.clear();
-        Serial.print("Button press");
-      }
+  // Push whatever changed on screen this pass in one go
+  {
+    PROFILE_SCOPE("display");
+    display.flush();
+  }
+  {
+    PROFILE_SCOPE("lcd");
+    lcd.update();
+  }
+  {
+    PROFILE_SCOPE("led");
+    strip.show();
+  }
+}
 
-      break;
-    case READING: {
-      // Button has been pressed and we're now reading
-      // While we wait for the time to elapse, collect many samples
-      // and do plenty of averaging to get an accurate value, as well as check for the max value.
-      // Also occasionally show the current value to the user
-      if (currentTime > stateChangeTime) {
-        deviceMode = COOLDOWN;
-        float avgRawValue = fullSampleTotal / fullSampleCount;
-        cooldownLastCalled = millis();
-        countdown2 = COOLDOWN_TIME / 1000;
-        maxPPM = calculatePPM(maxRawValue);
-        avgPPM = calculatePPM(avgRawValue);
-        maxBAC = calculateBAC(maxRawValue);
-        avgBAC = calculateBAC(avgRawValue);
-
-        String StringMaxPPM = String(maxPPM);
-        String StringAvgPPM = String(avgPPM);
-
-        Particle.publish("PPMevent", StringMaxPPM);
-        Particle.publish("PPMevent2", StringAvgPPM);
-
-        updateDisplay();
-
-        if(avgPPM >= HIGH_PPM) {
-          handleLED(SOLID, PixelColorRed);
-        } else if (avgPPM >= MEDIUM_PPM) {
-          handleLED(SOLID, PixelColorYellow);
-        } else {
-          handleLED(SOLID, PixelColorGreen);
-        }
-      }
+// Mode actions, run by the state machine. Entering a mode sets up its screen and LED and arms
+// the timeout that ends it; leaving it stops its timers.
+void enterWarmingUp() {
+  // Wait, flash the led red, and count down how long we have to wait while warming up the mq3 sensor
+  trace.mode(currentTime, TRACE_MODE_WARMING_UP);
+  resultsShown = false;
+  display.clear();
+  display.setCursor(0, 0);
+  display.print("WARMING UP...");
+  warmup.reset();
+  warmupStartTime = currentTime;
+
+  // Count down to the cap; it usually finishes well before that
+  countdown = WARMING_UP_MAX_TIME / 1000;
+  showCountdown();
+  scheduler.start(countdownTask, COUNTDOWN_PERIOD, currentTime);
+  scheduler.start(modeTimeoutTask, WARMING_UP_MAX_TIME, currentTime);
+
+  flashLED(WARMING_UP_LED_TIME_DIFFERENCE, PixelColorRed);
+}
 
-      if (currentTime - lastSensorReadTime > MS_BETWEEN_SAMPLES) {
-        smallSampleTotal += analogRead(MQ3_PIN);
-        smallSampleCount++;
-        lastSensorReadTime = currentTime;
-      }
+void enterIdle() {
+  // Mode when nothing is happening and we're just waiting for a button press
+  trace.mode(currentTime, TRACE_MODE_IDLE);
+}
 
-      int smallSampleAvg = 0;
-      if (smallSampleCount == 10) { 
-        smallSampleAvg = smallSampleTotal * 0.1;
-        fullSampleTotal += smallSampleAvg;
-        fullSampleCount++;
-
-        // Determine if the average is the max
-        if(smallSampleAvg > maxRawValue) {
-          maxRawValue = smallSampleAvg;
-        }
-
-        smallSampleTotal = 0;
-        smallSampleCount = 0;
-
-        lcd.setCursor(0, 0);
-        lcd.print("READING...");
-
-        if (millis() - readingLastCalled > 1000) {
-          lcd.setCursor(14, 0);
-          if(countdown1 <= 9) {
-            lcd.print(0);
-            lcd.setCursor(15, 0);
-          }
-
-          lcd.print(--countdown1);
-          readingLastCalled = millis();
-        }
-
-        lcd.setCursor(0, 1);
-        if (displayMode == PPM) {
-          lcd.print("PPM:");
-          Serial.print("PPM: ");
-          lcd.setCursor(4, 1);
-          float ppm = calculatePPM(smallSampleAvg);
-          lcd.print(ppm);
-          Serial.println(ppm);
-        } else if (displayMode == BAC) {
-          lcd.print("BAC:");
-          Serial.print("BAC: ");
-          lcd.setCursor(4, 1);
-          float bac = calculateBAC(calculatePPM(smallSampleAvg));
-          lcd.print(bac);
-          Serial.println(bac);
-        }
-      }
+void enterReading() {
+  // Button has been pressed and we're now reading
+  // While we wait for the time to elapse, collect many samples
+  // and do plenty of averaging to get an accurate value, as well as check for the max value.
+  // Also occasionally show the current value to the user
+  trace.mode(currentTime, TRACE_MODE_READING);
+  sampler.flush();
+  session.reset();
+  readingStartTime = currentTime;
+  resultsShown = false;
+  display.clear();
+  display.setCursor(0, 0);
+  display.print("READING...");
+  DIAG_INFO("Button press");
+
+  countdown = READING_MODE_TIME / 1000;
+  showCountdown();
+  scheduler.start(countdownTask, COUNTDOWN_PERIOD, currentTime);
+  scheduler.start(modeTimeoutTask, READING_MODE_TIME, currentTime);
+
+  flashLED(READING_LED_TIME_DIFFERENCE, PixelColorYellow);
+}
 
-      handleLED(READING_LED_TIME_DIFFERENCE, PixelColorYellow);
-    } break;
-    case COOLDOWN: {
-      // Wait and countdown until cooldown time as elapsed
-      if (countdown2 == 0) {
-        deviceMode = IDLE;
-      }
+void enterCooldown() {
+  // Show the results and count down until the next reading is allowed
+  trace.mode(currentTime, TRACE_MODE_COOLDOWN);
+  BreathResult result = session.finish(baseLinePPM);
+  maxPPM = result.maxPPM;
+  avgPPM = result.avgPPM;
+  maxBAC = result.maxBAC;
+  avgBAC = result.avgBAC;
+  trace.result(currentTime, maxPPM, avgPPM);
+
+  DIAG_INFO("AVG PPM: %d +/- %.1f, MEDIAN PPM: %d, MAX PPM: %d", avgPPM, result.avgPPMConfidence,
+            result.medianPPM, maxPPM);
+
+  // Queue the result; publishResults() sends it along with anything else waiting
+  PublishRecord record;
+  record.timestamp = Time.isValid() ? Time.now() : 0;
+  record.maxPPM = maxPPM;
+  record.avgPPM = avgPPM;
+  record.maxBAC = bacMillionths(maxBAC);
+  record.avgBAC = bacMillionths(avgBAC);
+  record.duration = (currentTime - readingStartTime) / 100;
+  publishQueue.push(record);
+  logResult(record);
+
+  updateDisplay();
+  resultsShown = true;
+
+  countdown = COOLDOWN_TIME / 1000;
+  showCountdown();
+  scheduler.start(countdownTask, COUNTDOWN_PERIOD, currentTime);
+  scheduler.start(modeTimeoutTask, COOLDOWN_TIME, currentTime);
+
+  if(avgPPM >= HIGH_PPM) {
+    setLED(PixelColorRed);
+  } else if (avgPPM >= MEDIUM_PPM) {
+    setLED(PixelColorYellow);
+  } else {
+    setLED(PixelColorGreen);
+  }
+}
+
+// Tasks
+
+// Feed the edges the interrupt caught into the gesture recognizer and act on what comes out
+void pollButton() {
+  PROFILE_SCOPE("button");
+  ButtonEdge edge;
+  while (button.next(edge)) {
+    trace.button(edge.time, edge.pressed);
+    gestures.edge(edge.time, edge.pressed);
+  }
+  gestures.update(currentTime);
+
+  BUTTON_ACTION action;
+  while (gestures.next(action)) {
+    handleButton(action);
+  }
+}
+
+void handleButton(BUTTON_ACTION action) {
+  if (action == PRESSED || action == HOLD) {
+    modes.dispatch(MODE_EVENT_BUTTON);
+  } else if (action == DOUBLE_CLICK) {
+    toggleDisplayMode();
+  }
+}
+
+// Switch between PPM and BAC. A reading in progress picks it up with its next window;
+// results on screen are redrawn straight away.
+void toggleDisplayMode() {
+  displayMode = displayMode == PPM ? BAC : PPM;
+  if (resultsShown) {
+    updateDisplay();
+    if (modes.state() == COOLDOWN) {
+      showCountdown();
+    }
+  }
+}
+
+void processSamples() {
+  PROFILE_SCOPE("samples");
+  // Pick up whatever the sampler has captured since the last run
+  sampleBatchCount = sampler.drain(sampleBatch, SAMPLE_BATCH_SIZE);
+  trace.samples(currentTime, sampleBatch, sampleBatchCount);
+
+  // Only the current mode looks at them, and it may move on once they are in
+  modes.update();
+  modes.dispatch(MODE_EVENT_SAMPLES);
+}
+
+void updateWarmingUp() {
+  warmup.addSamples(sampleBatch, sampleBatchCount);
+}
+
+bool warmupSettled() {
+  return warmup.stable();
+}
+
+void updateIdle() {
+  // Keep following the clean-air level while nobody is blowing
+  baseline.addSamples(sampleBatch, sampleBatchCount);
+  if (baseline.valid()) {
+    baseLinePPM = baseline.ppm();
+  }
+}
 
-      if (millis() - cooldownLastCalled > 1000) {
-        lcd.setCursor(14, 0);
-        if(countdown2 <= 9) {
-          lcd.print(0);
-          lcd.setCursor(15, 0);
-        }
+void updateReading() {
+  // Fold the new samples into filtered windows. Only the newest window is shown,
+  // so a large batch after a slow pass doesn't turn into a burst of LCD writes.
+  int smallSampleAvg = session.addSamples(sampleBatch, sampleBatchCount);
+  if (smallSampleAvg >= 0) {
+    // Fixed-width fields, so a shorter number overwrites all of a longer one
+    char field[NUMBER_FIELD_SIZE];
+    display.setCursor(0, 1);
+    if (displayMode == PPM) {
+      int32_t ppm = calculatePPMQ(smallSampleAvg);
+      formatFixed<16>(field, 8, ppm, 2);
+      display.print("PPM:");
+      display.print(field);
+      DIAG_INFO("PPM: %.2f", MQ3FixedConverter::ppmToFloat(ppm));
+    } else if (displayMode == BAC) {
+      int32_t bac = calculateBACQ(smallSampleAvg, baseLinePPM);
+      formatFixed<24>(field, 8, bac, 4);
+      display.print("BAC:");
+      display.print(field);
+      DIAG_INFO("BAC: %.5f", MQ3FixedConverter::bacToFloat(bac));
+    }
 
-        lcd.print(--countdown2);
-        cooldownLastCalled = millis();
+    // Provisional result from the rising edge of the breath, refined with every window.
+    // It takes over the top row up to the countdown; the framebuffer only sends the characters that change.
+    int estimate = session.estimateRawValue();
+    if (estimate >= 0) {
+      display.setCursor(0, 0);
+      if (displayMode == PPM) {
+        formatFixed<16>(field, 6, calculatePPMQ(estimate), 0);
+        display.print("EST PPM:");
+      } else {
+        formatFixed<24>(field, 6, calculateBACQ(estimate, baseLinePPM), 4);
+        display.print("EST BAC:");
       }
-    } break;
-    default:
-      // We somehow aren't in a valid mode. Indicate something is wrong.
-      handleLED(READING_LED_TIME_DIFFERENCE, PixelColorRed);
-      break;
+      display.print(field);
+    }
+  }
+}
+
+bool breathDone() {
+  return session.breathFinished();
+}
+
+void toggleLED() {
+  ledFlashOn = !ledFlashOn;
+  strip.setPixelColor(LED_INDEX, ledFlashOn ? ledFlashColor : PixelColorOff);
+}
+
+void tickCountdown() {
+  if (countdown > 0) {
+    countdown--;
   }
+  showCountdown();
+}
+
+void endMode() {
+  modes.dispatch(MODE_EVENT_TIMEOUT);
+}
+
+void stopModeTimers() {
+  scheduler.stop(countdownTask);
+  scheduler.stop(modeTimeoutTask);
+}
 
-  strip.show();
+void logModeChange(uint8_t from, uint8_t event, uint8_t to) {
+  DIAG_DEBUG("Mode %d -> %d on event %d", (int)from, (int)to, (int)event);
 }
 
+// Warm-up is over, either because the sensor settled or because it hit the cap
+void finishWarmingUp() {
+  stopModeTimers();
+  warmupTimeMs = currentTime - warmupStartTime;
+  DIAG_INFO("Warm-up took %d ms%s", warmupTimeMs, warmup.stable() ? "" : " (gave up waiting for a stable reading)");
+
+  // A settled reading right after power-up is clean air, unless something better was stored
+  if (warmup.stable() && !baseline.valid()) {
+    baseline.seed((int32_t)(warmup.level() * (1 << BASELINE_FRAC_BITS)));
+    baseLinePPM = baseline.ppm();
+  }
+
+  display.clear();
+  display.setCursor(0, 0);
+  display.print("READY...");
+}
 
+// True once the event 'queue' has in flight is settled one way or the other
+bool settleSend(PublishQueue &queue, const particle::Future<bool> &send, const char *name) {
+  if (queue.inFlight() == 0) {
+    return true;
+  } else if (!send.isDone()) {
+    return false;
+  }
 
-float calculatePPM(float rawValue) {
-  float voltage = rawValue * 0.00122100122; // 0.00122100122 is 5/4095.0, processor is slow so need to avoid division.
-  return voltage * 909.090909091; // 909.090909091 is 1000/1.1
+  uint8_t sent = queue.inFlight();
+  if (send.isSucceeded()) {
+    queue.delivered();
+    DIAG_INFO("Published %u %s, %u pending", (unsigned)sent, name, (unsigned)queue.pending());
+  } else {
+    queue.undelivered();
+    DIAG_WARN("Publish failed, %u %s pending", (unsigned)queue.pending(), name);
+  }
+  return true;
 }
 
-float calculateBAC(float rawValue) {
-  float voltage = rawValue * 0.00122100122; // 0.00122100122 is 5/4095.0, processor is slow so need to avoid division.
+void publishResults() {
+  PROFILE_SCOPE("publish");
+  // Once a send is settled, the next event (a resend of this one included) waits for the next
+  // flush, so there is never more than one per PUBLISH_FLUSH_PERIOD
+  bool settling = publishQueue.inFlight() > 0;
+  if (!settleSend(publishQueue, resultsSend, "results") || settling) {
+    return;
+  }
 
-#ifdef LINEAR_BAC_CALC
-  float ppm = voltage * 909.090909091;
+  // While offline results just stay queued, and go out together once the cloud is back
+  if (publishQueue.pending() == 0 || !Particle.connected()) {
+    return;
+  }
 
-  return (ppm - baseLinePPM) / 4600.0;
-#else
-  int R0 = 287; // Calculated from doing RS_gas / 60 during one test
-  int R2 = 2000;
+  if (publishQueue.flush(publishBatch)) {
+    scheduler.start(publishTask, PUBLISH_CHECK_PERIOD, currentTime);
+  }
+}
 
-  float RS_gas = ((5.0 * R2)/voltage) - R2; 
-   /*-Replace the value of R0 with the value of R0 in your test -*/
-  float ratio = RS_gas/R0;// ratio = RS/R0
-  double x = 0.4*ratio;   
-  float BAC = pow(x,-1.431);  //BAC in mg/L
+// NO_ACK so loop() doesn't stop for the cloud's reply; publishResults() checks on the send later
+bool publishBatch(const char *payload) {
+  resultsSend = Particle.publish("breathResults", payload, PRIVATE | NO_ACK);
+  return !resultsSend.isFailed();
+}
 
-  return BAC * 0.0001;
-#endif
+// BAC as sent in a PublishRecord. Anything past 0.065 is off the sensor's scale anyway.
+uint16_t bacMillionths(float bac) {
+  if (bac <= 0) {
+    return 0;
+  }
+  return bac < 0.065f ? (uint16_t)(bac * 1000000.0f + 0.5f) : 65000;
 }
 
 // Method to update the display with Max and avg ppm or bac values
+// Values are 6 wide so they stop short of the countdown in the top right corner
 void updateDisplay() {
-  lcd.clear();
+  char field[NUMBER_FIELD_SIZE];
+  display.clear();
 
   if(displayMode == PPM) {
-    lcd.setCursor(0, MAX_ROW);
-    lcd.print("MAX PPM:");
-    lcd.setCursor(8, MAX_ROW);
-    lcd.print(maxPPM);
-
-    lcd.setCursor(0, AVG_ROW);
-    lcd.print("AVG PPM:");
-    lcd.setCursor(8, AVG_ROW);
-    lcd.print(avgPPM);
+    display.setCursor(0, MAX_ROW);
+    display.print("MAX PPM:");
+    formatInt(field, 6, maxPPM);
+    display.print(field);
+
+    display.setCursor(0, AVG_ROW);
+    display.print("AVG PPM:");
+    formatInt(field, 6, avgPPM);
+    display.print(field);
   } else {
-    lcd.setCursor(0, MAX_ROW);
-    lcd.print("MAX BAC:");
-    lcd.setCursor(8, MAX_ROW);
-    lcd.print(maxBAC);
+    display.setCursor(0, MAX_ROW);
+    display.print("MAX BAC:");
+    formatFloat(field, 6, maxBAC, 4);
+    display.print(field);
+
+    display.setCursor(0, AVG_ROW);
+    display.print("AVG BAC:");
+    formatFloat(field, 6, avgBAC, 4);
+    display.print(field);
+  }
+}
 
-    lcd.setCursor(0, AVG_ROW);
-    lcd.print("AVG BAC:");
-    lcd.setCursor(8, AVG_ROW);
-    lcd.print(avgBAC);
+// Store the tracked baseline so the next power-up starts from it
+void saveBaseline() {
+  int32_t rawQ = baseline.rawQ();
+  if (!baseline.valid() || abs(rawQ - savedBaselineQ) < BASELINE_SAVE_DELTA) {
+    return;
   }
+
+  BaselineRecord record;
+  record.magic = BASELINE_RECORD_MAGIC;
+  record.reserved = 0;
+  record.rawQ = rawQ;
+  record.check = ~(uint32_t)rawQ;
+  EEPROM.put(EEPROM_BASELINE_ADDRESS, record);
+  savedBaselineQ = rawQ;
 }
 
-// LED control function using a desired color and time between flashes
-void handleLED(int timeDifference, int color) {
+bool loadBaseline() {
+  BaselineRecord record;
+  EEPROM.get(EEPROM_BASELINE_ADDRESS, record);
+  if (record.magic != BASELINE_RECORD_MAGIC || record.check != ~(uint32_t)record.rawQ) {
+    return false;
+  }
 
-  if(timeDifference != SOLID) {
-    if(currentTime > nextLedFlashTime) {
-      ledFlashOn = !ledFlashOn;
-      nextLedFlashTime += READING_LED_TIME_DIFFERENCE;
+  baseline.seed(record.rawQ);
+  savedBaselineQ = record.rawQ;
+  return true;
+}
+
+// Collect a line from Serial without blocking, then run it as a command
+void pollSerial() {
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c == '\r' || c == '\n') {
+      if (commandLength > 0) {
+        commandLine[commandLength] = '\0';
+        handleCommand(commandLine);
+        commandLength = 0;
+      }
+    } else if (commandLength < COMMAND_LINE_LENGTH - 1) {
+      commandLine[commandLength++] = c;
     }
+  }
+}
 
-    if (ledFlashOn) {
-      strip.setPixelColor(LED_INDEX, color);
-    } else {
-      strip.setPixelColor(LED_INDEX, 0);
+void handleCommand(const char *command) {
+  if (strcmp(command, "prof") == 0) {
+    // Timings in microseconds; histogram buckets are <2us, <4us, <8us, ...
+    char line[128];
+    for (uint8_t i = 0; i < profiler.sectionCount(); i++) {
+      profiler.format(i, line, sizeof(line));
+      Serial.println(line);
     }
+  } else if (strcmp(command, "prof reset") == 0) {
+    profiler.reset();
+    Serial.println("profiler reset");
+  } else if (strncmp(command, "log", 3) == 0 && (command[3] == '\0' || command[3] == ' ')) {
+    // "log" dumps the whole history, "log <from> [<to>]" one range of Unix times
+    unsigned long from = 0;
+    unsigned long to = UINT32_MAX;
+    sscanf(command + 3, "%lu %lu", &from, &to);
+    Serial.println("seq,time,maxPPM,avgPPM,maxBAC,avgBAC,duration");
+    uint8_t found = sessionLog.query(from, to, printSession);
+    Serial.printlnf("%u of %u results", found, sessionLog.count());
+  } else if (strcmp(command, "stats") == 0) {
+    printTaskStats("button", buttonTask);
+    printTaskStats("samples", sampleTask);
+    printTaskStats("led", ledTask);
+    printTaskStats("countdown", countdownTask);
+    printTaskStats("timeout", modeTimeoutTask);
+    printTaskStats("publish", publishTask);
+    printTaskStats("baseline", baselineSaveTask);
+    printTaskStats("serial", serialTask);
+    printTaskStats("log", logTask);
+    printTaskStats("summary", summaryTask);
+    printTaskStats("history", historyTask);
+    rgb_lcd::BusStats bus = rgb_lcd::busStats();
+    Serial.printlnf("i2c: %u transactions, %u bytes, %u us", (unsigned)bus.transactions, (unsigned)bus.bytes,
+                    (unsigned)bus.micros);
+    Serial.printlnf("dropped: %u samples, %u button edges, %u LCD writes, %u log lines",
+                    (unsigned)sampler.droppedSamples(), (unsigned)button.droppedEdges(),
+                    (unsigned)lcd.droppedWrites(), (unsigned)diag.dropped());
   } else {
-    strip.setPixelColor(LED_INDEX, color);
-  }
-}
-
-// Function to check if the button is currently being held, double clicked or single clicked, and handle debouncing - custom made
-BUTTON_ACTION checkButton(int buttonReading) {
-  if (!watchingButton && buttonReading == HIGH && lastButtonReading == LOW) {
-    buttonHoldBeginTime = millis();
-    debounceEndWaitTime += DEBOUNCE_TIME;
-    watchingButton = true;
-  }
-  
-  if (watchingButton) {
-    if (currentTime > debounceEndWaitTime) {
-
-      if(millis() - buttonHoldBeginTime > DOUBLE_CLICK_WAIT_TIME) {
-        if(buttonReading == HIGH){
-          lastButtonReading = buttonReading;
-          return HOLD;
-        } else if (buttonReading == LOW) {
-          watchingButton = false;
-          return UNPRESSED;
-        }
-      } else if (lastButtonReading == LOW && buttonReading == HIGH) {
-        watchingButton = false;
-        lastButtonReading = buttonReading;
-        return DOUBLE_CLICK;
-      }
-    } else {
-      return UNPRESSED;
+    Serial.println("commands: prof, prof reset, stats, log [from [to]]");
+  }
+}
+
+void printTaskStats(const char *name, TaskId id) {
+  const TaskStats &stats = scheduler.stats(id);
+  Serial.printlnf("%-10s %u runs, %u late, %u skipped, %u ms latest", name, (unsigned)stats.runs,
+                  (unsigned)stats.deadlineMisses, (unsigned)stats.skippedPeriods, (unsigned)stats.maxLatenessMs);
+}
+
+void updateSummaries() {
+  profiler.summary(profileSummary, sizeof(profileSummary));
+  updateHealth();
+}
+
+// Everything that can be lost or late, for the "health" variable; anything new also gets logged
+void updateHealth() {
+  uint32_t misses = scheduler.deadlineMisses();
+  uint32_t samples = sampler.droppedSamples();
+  uint32_t edges = button.droppedEdges();
+  uint32_t lcdWrites = lcd.droppedWrites();
+  rgb_lcd::BusStats bus = rgb_lcd::busStats();
+  snprintf(health, sizeof(health), "late=%u samples=%u edges=%u lcd=%u log=%u i2c=%u/%uB/%uus", (unsigned)misses,
+           (unsigned)samples, (unsigned)edges, (unsigned)lcdWrites, (unsigned)diag.dropped(),
+           (unsigned)bus.transactions, (unsigned)bus.bytes, (unsigned)bus.micros);
+
+  uint32_t losses = misses + samples + edges + lcdWrites;
+  if (losses != reportedLosses) {
+    reportedLosses = losses;
+    DIAG_WARN("%u late tasks, dropped %u samples, %u button edges, %u LCD writes", (unsigned)misses,
+              (unsigned)samples, (unsigned)edges, (unsigned)lcdWrites);
+  }
+}
+
+// Write queued log lines, but only as many as fit in the Serial buffer right now
+void drainLog() {
+  PROFILE_SCOPE("log");
+  diag.drain(writeLogLine, Serial.availableForWrite());
+}
+
+void writeLogLine(const char *line, size_t length) {
+  Serial.write((const uint8_t *)line, length);
+}
+
+uint32_t logClock() {
+  return millis();
+}
+
+// Sensor trace frames go out on the same Serial port as the text output (see SensorTrace.h)
+void writeTrace(const uint8_t *data, uint16_t length) {
+  Serial.write(data, length);
+}
+
+void readEeprom(uint16_t address, uint8_t *data, uint16_t length) {
+  for (uint16_t i = 0; i < length; i++) {
+    data[i] = EEPROM.read(address + i);
+  }
+}
+
+void writeEeprom(uint16_t address, const uint8_t *data, uint16_t length) {
+  for (uint16_t i = 0; i < length; i++) {
+    EEPROM.write(address + i, data[i]);
+  }
+}
+
+void logResult(const PublishRecord &record) {
+  SessionLogRecord entry;
+  entry.timestamp = record.timestamp;
+  entry.maxPPM = record.maxPPM;
+  entry.avgPPM = record.avgPPM;
+  entry.maxBAC = record.maxBAC;
+  entry.avgBAC = record.avgBAC;
+  entry.duration = record.duration;
+  sessionLog.append(entry);
+}
+
+void printSession(const SessionLogRecord &record) {
+  Serial.printlnf("%lu,%lu,%u,%u,%u,%u,%u", (unsigned long)record.sequence, (unsigned long)record.timestamp,
+                  record.maxPPM, record.avgPPM, record.maxBAC, record.avgBAC, record.duration);
+}
+
+// Cloud function: "<from> [<to>]" in Unix time, or nothing for everything. The results go out
+// as "breathHistory" events in the breathResults format; returns how many there will be. A new
+// request replaces one still streaming, and anything of the old one's still queued is dropped.
+int requestHistory(String command) {
+  unsigned long from = 0;
+  unsigned long to = UINT32_MAX;
+  if (sscanf(command.c_str(), "%lu %lu", &from, &to) == 0 || from > to) {
+    return -1;
+  }
+
+  if (scheduler.isActive(historyTask)) {
+    DIAG_INFO("History request replaces one with %u results still queued", historyQueue.pending());
+    scheduler.stop(historyTask);
+    historyQueue.clear();
+  }
+
+  uint8_t count = sessionLog.count(from, to);
+  if (count == 0) {
+    return 0;
+  }
+
+  historySequence = sessionLog.lastSequence() - sessionLog.count() + 1 + sessionLog.find(from);
+  historyFrom = from;
+  historyTo = to;
+  scheduler.start(historyTask, 0, currentTime);
+  return count;
+}
+
+// Top up the history queue from the log and send one event's worth of it
+void publishHistory() {
+  PROFILE_SCOPE("history");
+  if (!settleSend(historyQueue, historySend, "history results")) {
+    return;
+  }
+
+  uint32_t oldest = sessionLog.lastSequence() - sessionLog.count() + 1;
+  if (historySequence < oldest) {
+    historySequence = oldest;   // Overwritten while we were sending
+  }
+
+  // By the same rule as sessionLog.count(), so the request gets as many as it was told
+  SessionLogRecord entry;
+  while (historyQueue.pending() < PUBLISH_QUEUE_SLOTS && historySequence <= sessionLog.lastSequence()) {
+    uint8_t n = historySequence++ - oldest;
+    if (!sessionLog.inRange(n, historyFrom, historyTo) || !sessionLog.get(n, entry)) {
+      continue;
     }
-  } 
 
-  lastButtonReading = buttonReading;
+    PublishRecord record;
+    record.timestamp = entry.timestamp;
+    record.maxPPM = entry.maxPPM;
+    record.avgPPM = entry.avgPPM;
+    record.maxBAC = entry.maxBAC;
+    record.avgBAC = entry.avgBAC;
+    record.duration = entry.duration;
+    historyQueue.push(record);
+  }
+
+  if (historyQueue.pending() == 0) {
+    scheduler.stop(historyTask);
+  } else if (Particle.connected()) {
+    historyQueue.flush(publishHistoryBatch);
+  }
+}
+
+bool publishHistoryBatch(const char *payload) {
+  historySend = Particle.publish("breathHistory", payload, PRIVATE | NO_ACK);
+  return !historySend.isFailed();
+}
+
+// Cloud function to turn the sensor trace "on" or "off"
+int setTrace(String command) {
+  if (command == "on") {
+    trace.setEnabled(true);
+    trace.header(MS_BETWEEN_SAMPLES, baseLinePPM);
+    return 1;
+  } else if (command == "off") {
+    trace.setEnabled(false);
+    return 0;
+  }
+  return -1;
+}
+
+// Two-digit countdown in the top right corner
+void showCountdown() {
+  char field[3];
+  formatInt(field, 2, countdown, '0');
+  display.setCursor(14, 0);
+  display.print(field);
+}
+
+// Flash the LED in a color with the given time between toggles
+void flashLED(int timeDifference, int color) {
+  ledFlashColor = color;
+  ledFlashOn = 1;
+  strip.setPixelColor(LED_INDEX, color);
+  scheduler.setPeriod(ledTask, timeDifference);
+  scheduler.start(ledTask, timeDifference, currentTime);
+}
 
-  return buttonReading == HIGH ? PRESSED : UNPRESSED;
+void setLED(int color) {
+  scheduler.stop(ledTask);
+  strip.setPixelColor(LED_INDEX, color);
 }
\ No newline at end of file
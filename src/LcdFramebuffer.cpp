@@ -0,0 +1,94 @@
+#include "LcdFramebuffer.h"
+
+// Worst case flush: single-cell runs with LCD_MERGE_GAP + 1 unchanged cells between them, each a cursor move plus data
+static_assert(LCD_ROWS * ((LCD_COLS + LCD_MERGE_GAP + 1) / (LCD_MERGE_GAP + 2)) * 2 <= I2C_QUEUE_HIGH_SLOTS,
+              "a full flush has to fit in the LCD's queue");
+
+LcdFramebuffer::LcdFramebuffer(rgb_lcd &lcd) :
+  lcd(lcd), cursorCol(0), cursorRow(0), dirty(false), lcdDrops(lcd.droppedWrites())
+{
+  // rgb_lcd::begin() clears the display, so both copies start out blank
+  memset(pending, ' ', sizeof(pending));
+  memset(shown, ' ', sizeof(shown));
+}
+
+void LcdFramebuffer::clear() {
+  memset(pending, ' ', sizeof(pending));
+  cursorCol = 0;
+  cursorRow = 0;
+  dirty = true;
+}
+
+void LcdFramebuffer::setCursor(uint8_t col, uint8_t row) {
+  cursorCol = col;
+  cursorRow = row < LCD_ROWS ? row : LCD_ROWS - 1;
+}
+
+size_t LcdFramebuffer::write(uint8_t value) {
+  // Anything past the right edge would land in off-screen DDRAM anyway, so just drop it
+  if (cursorCol < LCD_COLS) {
+    if (pending[cursorRow][cursorCol] != value) {
+      pending[cursorRow][cursorCol] = value;
+      dirty = true;
+    }
+    cursorCol++;
+  }
+
+  return 1;
+}
+
+void LcdFramebuffer::invalidate() {
+  // Make every shown cell differ from its pending cell
+  for (uint8_t row = 0; row < LCD_ROWS; row++) {
+    for (uint8_t col = 0; col < LCD_COLS; col++) {
+      shown[row][col] = ~pending[row][col];
+    }
+  }
+  dirty = true;
+}
+
+uint8_t LcdFramebuffer::flush() {
+  // A dropped write means the glass no longer matches 'shown'
+  if (lcd.droppedWrites() != lcdDrops) {
+    lcdDrops = lcd.droppedWrites();
+    invalidate();
+  }
+
+  if (!dirty || lcd.busy()) {
+    return 0;
+  }
+
+  uint8_t runs = 0;
+  for (uint8_t row = 0; row < LCD_ROWS; row++) {
+    uint8_t col = 0;
+    while (col < LCD_COLS) {
+      if (pending[row][col] == shown[row][col]) {
+        col++;
+        continue;
+      }
+
+      // Grow the run while the gap of unchanged cells stays small enough to be cheaper than a new setCursor
+      uint8_t last = col;
+      for (uint8_t c = col + 1; c < LCD_COLS && c - last <= LCD_MERGE_GAP + 1; c++) {
+        if (pending[row][c] != shown[row][c]) {
+          last = c;
+        }
+      }
+
+      uint8_t length = last - col + 1;
+      lcd.setCursor(col, row);
+      lcd.writeData(&pending[row][col], length);
+      memcpy(&shown[row][col], &pending[row][col], length);
+
+      runs++;
+      col = last + 1;
+    }
+  }
+
+  dirty = false;
+  return runs;
+}
+
+bool LcdFramebuffer::isDirty() const {
+  return dirty;
+}
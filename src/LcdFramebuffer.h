@@ -0,0 +1,44 @@
+#ifndef LCD_FRAMEBUFFER_H
+#define LCD_FRAMEBUFFER_H
+
+#include "Particle.h"
+#include "Grove_LCD_RGB_Backlight.h"
+
+#define LCD_COLS 16
+#define LCD_ROWS 2
+#define LCD_MERGE_GAP 2 // Unchanged cells we'd rather resend than pay for another cursor move
+
+// Shadow copy of the 16x2 display. The app prints into RAM as often as it likes and flush()
+// only puts the cells that actually changed on the bus, one transaction per run of changes.
+class LcdFramebuffer : public Print
+{
+public:
+  LcdFramebuffer(rgb_lcd &lcd);
+
+  void clear();
+  void setCursor(uint8_t col, uint8_t row);
+
+  virtual size_t write(uint8_t);
+  using Print::write;
+
+  // Forget what we think is on the glass, e.g. after the display was reset. The next flush redraws everything.
+  void invalidate();
+
+  // Send changed cells to the display. Returns the number of runs written. While the LCD still
+  // has queued traffic nothing is sent, so a flush (at most 16 transactions) always fits in the
+  // LCD's empty queue; if the LCD dropped writes anyway, everything is redrawn.
+  uint8_t flush();
+
+  bool isDirty() const;
+
+private:
+  rgb_lcd &lcd;
+  uint8_t pending[LCD_ROWS][LCD_COLS];
+  uint8_t shown[LCD_ROWS][LCD_COLS];
+  uint8_t cursorCol;
+  uint8_t cursorRow;
+  bool dirty;
+  uint32_t lcdDrops;    // lcd.droppedWrites() as of the last flush
+};
+
+#endif // LCD_FRAMEBUFFER_H
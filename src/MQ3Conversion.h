@@ -0,0 +1,85 @@
+#ifndef MQ3_CONVERSION_H
+#define MQ3_CONVERSION_H
+
+#include "FixedPoint.h"
+
+#define MQ3_ADC_MAX 4095
+#define MQ3_R0 287            // Calculated from doing RS_gas / 60 during one test
+#define MQ3_R2 2000           // Load resistor
+#define MQ3_CLEAN_AIR_RATIO 60  // RS / R0 in clean air, from the datasheet
+#define MQ3_BAC_EXPONENT -1.431
+#define MQ3_LINEAR_PPM_PER_BAC 4600
+
+// Sensor calibration constants for the power-law BAC curve. Add a new profile struct
+// per calibrated sensor and pass it to MQ3Lookup (see MQ3LookupTable.h).
+struct MQ3DefaultProfile
+{
+  static constexpr double R0 = MQ3_R0;
+  static constexpr double R2 = MQ3_R2;
+  static constexpr double EXPONENT = MQ3_BAC_EXPONENT;
+};
+
+// Converts raw 12-bit MQ3 ADC counts to PPM and BAC in fixed point.
+// Mirrors the float math that used to live in calculatePPM()/calculateBAC():
+//   voltage = raw * 5 / 4095,  ppm = voltage * 1000 / 1.1
+//   RS = 5 * R2 / voltage - R2,  BAC = (0.4 * RS / R0)^-1.431 * 0.0001
+// PPM comes back in Q.PPM_FRAC_BITS and BAC in Q.BAC_FRAC_BITS, since BAC values are a few thousandths
+// at most and need the extra fraction bits. The power law is evaluated as 2^(exponent * log2(x)),
+// which stays within 3e-4 relative (5 LSB at worst) of the double-precision reference; see
+// tools/conversion-bench.cpp for the numbers and what it costs next to pow().
+template <uint8_t PPM_FRAC_BITS = 16, uint8_t BAC_FRAC_BITS = 24>
+class MQ3Converter
+{
+  // PPM tops out around 4545, which needs 13 integer bits plus sign
+  static_assert(PPM_FRAC_BITS <= 18, "PPM does not fit in int32_t with more than 18 fraction bits");
+  static_assert(BAC_FRAC_BITS >= PPM_FRAC_BITS, "BAC needs at least as many fraction bits as PPM");
+
+public:
+  typedef QFormat<PPM_FRAC_BITS> PpmQ;
+  typedef QFormat<BAC_FRAC_BITS> BacQ;
+
+  static int32_t ppm(uint16_t raw) {
+    return (int32_t)raw * PPM_PER_COUNT;
+  }
+
+  // Nearest ADC code to a PPM value, the inverse of ppm()
+  static uint16_t raw(int32_t ppm) {
+    int32_t code = (ppm + PPM_PER_COUNT / 2) / PPM_PER_COUNT;
+    return code < 0 ? 0 : code > MQ3_ADC_MAX ? MQ3_ADC_MAX : (uint16_t)code;
+  }
+
+  // (ppm - baseline) / 4600, using a Q32 reciprocal so the divide disappears without losing precision
+  static int32_t bacLinear(uint16_t raw, int32_t baselinePpm) {
+    return (int32_t)(((int64_t)(ppm(raw) - baselinePpm) * LINEAR_BAC_RECIPROCAL_Q32) >> (32 - (BAC_FRAC_BITS - PPM_FRAC_BITS)));
+  }
+
+  static int32_t bac(uint16_t raw) {
+    if (raw == 0) {
+      return 0;               // No voltage across the load resistor: RS is infinite
+    } else if (raw >= MQ3_ADC_MAX) {
+      return INT32_MAX;       // RS is zero, the curve blows up
+    }
+
+    // x = 0.4 * RS / R0 = (0.4 * R2 * (4095 - raw)) / (R0 * raw)
+    int32_t log2X = BacQ::log2((uint32_t)(MQ3_R2 * 2 / 5) * (MQ3_ADC_MAX - raw)) - BacQ::log2((uint32_t)MQ3_R0 * raw);
+    return BacQ::exp2(BacQ::mul(BAC_EXPONENT, log2X) + LOG2_BAC_SCALE);
+  }
+
+  static float ppmToFloat(int32_t q) {
+    return PpmQ::toFloat(q);
+  }
+
+  static float bacToFloat(int32_t q) {
+    return BacQ::toFloat(q);
+  }
+
+private:
+  static constexpr int32_t PPM_PER_COUNT = PpmQ::fromDouble(5.0 / MQ3_ADC_MAX * 1000.0 / 1.1);
+  static constexpr int32_t BAC_EXPONENT = BacQ::fromDouble(MQ3_BAC_EXPONENT);
+  static constexpr int32_t LOG2_BAC_SCALE = BacQ::fromDouble(-13.287712379549449); // log2(0.0001)
+  static constexpr int64_t LINEAR_BAC_RECIPROCAL_Q32 = (int64_t)(4294967296.0 / MQ3_LINEAR_PPM_PER_BAC + 0.5);
+};
+
+typedef MQ3Converter<16, 24> MQ3FixedConverter;
+
+#endif // MQ3_CONVERSION_H
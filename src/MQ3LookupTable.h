@@ -0,0 +1,135 @@
+#ifndef MQ3_LOOKUP_TABLE_H
+#define MQ3_LOOKUP_TABLE_H
+
+#include "MQ3Conversion.h"
+
+#define MQ3_LUT_SIZE (MQ3_ADC_MAX + 1)
+#define MQ3_LUT_BAC_FRAC_BITS 24
+
+// Natural log and exp that the compiler can evaluate while building the table.
+// Double precision, only ever run at compile time.
+constexpr double lutLn(double x) {
+  double result = 0;
+  while (x >= 2.0) {
+    x *= 0.5;
+    result += 0.69314718055994531;
+  }
+  while (x < 1.0) {
+    x *= 2.0;
+    result -= 0.69314718055994531;
+  }
+
+  // ln(x) = 2 * atanh((x - 1) / (x + 1)), z is at most 1/3 here so the series converges quickly
+  double z = (x - 1.0) / (x + 1.0);
+  double z2 = z * z;
+  double term = z;
+  double series = 0;
+  for (int n = 1; n < 40; n += 2) {
+    series += term / n;
+    term *= z2;
+  }
+
+  return result + 2.0 * series;
+}
+
+constexpr double lutExp(double x) {
+  double scale = 1.0;
+  while (x > 0.69314718055994531) {
+    x -= 0.69314718055994531;
+    scale *= 2.0;
+  }
+  while (x < 0) {
+    x += 0.69314718055994531;
+    scale *= 0.5;
+  }
+
+  double term = 1.0;
+  double series = 1.0;
+  for (int n = 1; n < 24; n++) {
+    term *= x / n;
+    series += term;
+  }
+
+  return series * scale;
+}
+
+// BAC for every possible 12-bit ADC code, in Q8.24, built entirely at compile time so it lands in flash
+struct MQ3LookupTable
+{
+  int32_t bac[MQ3_LUT_SIZE];
+};
+
+template <typename PROFILE>
+constexpr MQ3LookupTable makeMQ3LookupTable() {
+  MQ3LookupTable table = {};
+
+  table.bac[0] = 0;
+  table.bac[MQ3_ADC_MAX] = INT32_MAX;
+  for (int raw = 1; raw < MQ3_ADC_MAX; raw++) {
+    // Same curve as MQ3Converter::bac(): (0.4 * RS / R0)^exponent * 0.0001
+    double x = (0.4 * PROFILE::R2 * (MQ3_ADC_MAX - raw)) / (PROFILE::R0 * raw);
+    double bac = lutExp(PROFILE::EXPONENT * lutLn(x)) * 0.0001;
+    double q = bac * (1 << MQ3_LUT_BAC_FRAC_BITS) + 0.5;
+    table.bac[raw] = q >= INT32_MAX ? INT32_MAX : (int32_t)q;
+  }
+
+  return table;
+}
+
+// Table-driven replacement for the power-law path of MQ3Converter, selected per calibration profile.
+// PPM is a single multiply, so it stays computed rather than spending another 16 KB of flash on it.
+template <typename PROFILE = MQ3DefaultProfile>
+class MQ3Lookup
+{
+public:
+  typedef MQ3Converter<16, MQ3_LUT_BAC_FRAC_BITS> Converter;
+
+  static int32_t ppm(uint16_t raw) {
+    return Converter::ppm(raw);
+  }
+
+  static int32_t bac(uint16_t raw) {
+    return TABLE.bac[raw > MQ3_ADC_MAX ? MQ3_ADC_MAX : raw];
+  }
+
+  // bac() for a sensor whose clean air currently reads baselinePpm (Q16.16) rather than the level
+  // PROFILE::R0 was measured at. 0 means no baseline yet and leaves the table value as it is.
+  static int32_t bac(uint16_t raw, int32_t baselinePpm) {
+    int32_t value = bac(raw);
+    if (baselinePpm <= 0 || value == INT32_MAX) {
+      return value;
+    }
+
+    int64_t scaled = ((int64_t)value * baselineScale(baselinePpm)) >> MQ3_LUT_BAC_FRAC_BITS;
+    return scaled > INT32_MAX ? INT32_MAX : (int32_t)scaled;
+  }
+
+  // R0 is RS in clean air over MQ3_CLEAN_AIR_RATIO, so a baseline gives a current R0' and every
+  // BAC on the curve moves by (R0 / R0')^exponent. In Q.MQ3_LUT_BAC_FRAC_BITS.
+  static int32_t baselineScale(int32_t baselinePpm) {
+    typedef typename Converter::BacQ BacQ;
+    uint16_t raw = Converter::raw(baselinePpm);
+    raw = raw < 1 ? 1 : raw > MQ3_ADC_MAX - 1 ? MQ3_ADC_MAX - 1 : raw;
+
+    // R0 / R0' = R0 * ratio / RS = R0 * ratio * raw / (R2 * (4095 - raw))
+    int32_t log2Ratio = BacQ::log2((uint32_t)(PROFILE::R0 * MQ3_CLEAN_AIR_RATIO) * raw) -
+                        BacQ::log2((uint32_t)PROFILE::R2 * (MQ3_ADC_MAX - raw));
+    return BacQ::exp2(BacQ::mul(BacQ::fromDouble(PROFILE::EXPONENT), log2Ratio));
+  }
+
+  static float ppmToFloat(int32_t q) {
+    return Converter::ppmToFloat(q);
+  }
+
+  static float bacToFloat(int32_t q) {
+    return Converter::bacToFloat(q);
+  }
+
+private:
+  static constexpr MQ3LookupTable TABLE = makeMQ3LookupTable<PROFILE>();
+};
+
+template <typename PROFILE>
+constexpr MQ3LookupTable MQ3Lookup<PROFILE>::TABLE;
+
+#endif // MQ3_LOOKUP_TABLE_H
@@ -0,0 +1,41 @@
+#include "MQ3Sampler.h"
+
+MQ3Sampler::MQ3Sampler(pin_t pin, unsigned int periodMs) :
+  pin(pin), sampleTimer(periodMs, &MQ3Sampler::onSampleTimer, *this), sampleCount(0)
+{
+}
+
+void MQ3Sampler::begin() {
+  samples.clear();
+  sampleTimer.start();
+}
+
+void MQ3Sampler::stop() {
+  sampleTimer.stop();
+}
+
+uint16_t MQ3Sampler::drain(uint16_t *out, uint16_t maxCount) {
+  return samples.popBatch(out, maxCount);
+}
+
+void MQ3Sampler::flush() {
+  samples.clear();
+}
+
+uint16_t MQ3Sampler::pending() const {
+  return samples.size();
+}
+
+uint32_t MQ3Sampler::droppedSamples() const {
+  return samples.overflowCount();
+}
+
+uint32_t MQ3Sampler::totalSamples() const {
+  return sampleCount;
+}
+
+// Runs on the system timer thread, so keep it short: one conversion and one push.
+void MQ3Sampler::onSampleTimer() {
+  samples.push((uint16_t)analogRead(pin));
+  sampleCount++;
+}
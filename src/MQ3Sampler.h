@@ -0,0 +1,39 @@
+#ifndef MQ3_SAMPLER_H
+#define MQ3_SAMPLER_H
+
+#include "Particle.h"
+#include "SampleRingBuffer.h"
+
+#define MQ3_SAMPLE_BUFFER_SIZE 64
+
+// Samples the MQ3 sensor at a fixed rate from a system timer and hands the raw ADC counts
+// to loop() through a lock-free ring buffer, so slow LCD/Serial/LED work in loop() no longer
+// stretches the time between samples.
+class MQ3Sampler
+{
+public:
+  MQ3Sampler(pin_t pin, unsigned int periodMs);
+
+  void begin();
+  void stop();
+
+  // Copy up to maxCount queued samples (oldest first) into out. Call from loop() only.
+  uint16_t drain(uint16_t *out, uint16_t maxCount);
+
+  // Discard anything captured so far, e.g. right before a new reading starts.
+  void flush();
+
+  uint16_t pending() const;
+  uint32_t droppedSamples() const;
+  uint32_t totalSamples() const;
+
+private:
+  void onSampleTimer();
+
+  pin_t pin;
+  Timer sampleTimer;
+  SampleRingBuffer<uint16_t, MQ3_SAMPLE_BUFFER_SIZE> samples;
+  volatile uint32_t sampleCount;
+};
+
+#endif // MQ3_SAMPLER_H
@@ -0,0 +1,106 @@
+#ifndef NUMBER_FORMAT_H
+#define NUMBER_FORMAT_H
+
+#include <stdint.h>
+
+// Room for any int32_t with sign and decimal point, plus the terminator
+#define NUMBER_FIELD_SIZE 14
+
+// Fixed-width number formatting into a caller's buffer, for the LCD fields and anything else that
+// shouldn't go through String or Print's float code. Nothing is allocated and no float maths is
+// needed except in formatFloat().
+//
+// Each function writes exactly 'width' characters, right aligned and padded with 'pad', then a
+// terminator, and returns the number of characters. A width of 0 means just as wide as needed.
+// A value that doesn't fit is shown as '#' across the whole field rather than cut short.
+// 'out' must hold width + 1 characters, or NUMBER_FIELD_SIZE when width is 0.
+
+inline uint8_t formatOverflow(char *out, uint8_t width) {
+  uint8_t used = 0;
+  do {
+    out[used++] = '#';
+  } while (used < width);
+  out[used] = '\0';
+  return used;
+}
+
+// magnitude is the value times 10^decimals
+inline uint8_t formatScaled(char *out, uint8_t width, uint32_t magnitude, bool negative, uint8_t decimals, char pad = ' ') {
+  // Digits come out least significant first, so build the field backwards
+  char reversed[NUMBER_FIELD_SIZE];
+  uint8_t length = 0;
+  do {
+    if (length == decimals && decimals > 0) {
+      reversed[length++] = '.';
+    }
+    reversed[length++] = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while ((magnitude > 0 || length <= decimals) && length < NUMBER_FIELD_SIZE - 2);
+
+  uint8_t total = length + (negative ? 1 : 0);
+  if (width == 0) {
+    width = total;
+  }
+
+  if (total > width) {
+    return formatOverflow(out, width);
+  }
+
+  // A minus sign goes in front of zero padding but after space padding
+  uint8_t used = 0;
+  if (negative && pad == '0') {
+    out[used++] = '-';
+  }
+  while (used + total < width + (negative && pad == '0' ? 1 : 0)) {
+    out[used++] = pad;
+  }
+  if (negative && pad != '0') {
+    out[used++] = '-';
+  }
+  while (length > 0) {
+    out[used++] = reversed[--length];
+  }
+
+  out[used] = '\0';
+  return used;
+}
+
+inline uint8_t formatInt(char *out, uint8_t width, int32_t value, char pad = ' ') {
+  uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+  return formatScaled(out, width, magnitude, value < 0, 0, pad);
+}
+
+// A QFormat<FRAC_BITS> value (see FixedPoint.h) rounded to 'decimals' places
+template <uint8_t FRAC_BITS>
+inline uint8_t formatFixed(char *out, uint8_t width, int32_t q, uint8_t decimals, char pad = ' ') {
+  static const uint32_t POWERS_OF_TEN[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+  if (decimals > 6) {
+    decimals = 6;
+  }
+
+  uint64_t magnitude = q < 0 ? 0u - (uint32_t)q : (uint32_t)q;
+  magnitude = (magnitude * POWERS_OF_TEN[decimals] + ((uint64_t)1 << (FRAC_BITS - 1))) >> FRAC_BITS;
+  if (magnitude > UINT32_MAX) {
+    return formatOverflow(out, width);
+  }
+  return formatScaled(out, width, (uint32_t)magnitude, q < 0 && magnitude > 0, decimals, pad);
+}
+
+// For values that are already floats, e.g. BreathResult. One multiply instead of Print's
+// multiply per digit.
+inline uint8_t formatFloat(char *out, uint8_t width, float value, uint8_t decimals, char pad = ' ') {
+  static const float POWERS_OF_TEN[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+  if (decimals > 6) {
+    decimals = 6;
+  }
+
+  bool negative = value < 0;
+  float scaled = (negative ? -value : value) * POWERS_OF_TEN[decimals] + 0.5f;
+  if (!(scaled < 4294967040.0f)) {
+    return formatOverflow(out, width);   // Also catches NaN
+  }
+  uint32_t magnitude = (uint32_t)scaled;
+  return formatScaled(out, width, magnitude, negative && magnitude > 0, decimals, pad);
+}
+
+#endif // NUMBER_FORMAT_H
@@ -0,0 +1,131 @@
+#include "Profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(PARTICLE)
+#include "Particle.h"
+#elif defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+Profiler profiler;
+
+Profiler::Profiler() : count(0)
+{
+}
+
+ProfilerSection *Profiler::section(const char *name) {
+  for (uint8_t i = 0; i < count; i++) {
+    if (strcmp(sections[i].name, name) == 0) {
+      return &sections[i];
+    }
+  }
+
+  if (count == PROFILER_MAX_SECTIONS) {
+    return NULL;
+  }
+
+  ProfilerSection &section = sections[count++];
+  memset(&section, 0, sizeof(section));
+  section.name = name;
+  section.minTicks = UINT32_MAX;
+  return &section;
+}
+
+uint32_t Profiler::ticks() {
+#if defined(PARTICLE)
+  return System.ticks();
+#elif defined(ARDUINO)
+  return micros();
+#else
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+uint32_t Profiler::ticksPerMicrosecond() {
+#if defined(PARTICLE)
+  return System.ticksPerMicrosecond();
+#else
+  return 1;
+#endif
+}
+
+void Profiler::record(ProfilerSection *section, uint32_t elapsedTicks) {
+  section->count++;
+  section->totalTicks += elapsedTicks;
+  if (elapsedTicks < section->minTicks) {
+    section->minTicks = elapsedTicks;
+  }
+  if (elapsedTicks > section->maxTicks) {
+    section->maxTicks = elapsedTicks;
+  }
+
+  uint32_t us = elapsedTicks / ticksPerMicrosecond();
+  uint8_t bucket = 0;
+  while (us >= 2 && bucket < PROFILER_BUCKETS - 1) {
+    us >>= 1;
+    bucket++;
+  }
+  section->histogram[bucket]++;
+}
+
+void Profiler::reset() {
+  for (uint8_t i = 0; i < count; i++) {
+    const char *name = sections[i].name;
+    memset(&sections[i], 0, sizeof(sections[i]));
+    sections[i].name = name;
+    sections[i].minTicks = UINT32_MAX;
+  }
+}
+
+uint8_t Profiler::sectionCount() const {
+  return count;
+}
+
+size_t Profiler::format(uint8_t index, char *buffer, size_t size) const {
+  if (index >= count || size == 0) {
+    return 0;
+  }
+
+  const ProfilerSection &s = sections[index];
+  uint32_t perUs = ticksPerMicrosecond();
+  uint32_t mean = s.count ? (uint32_t)(s.totalTicks / s.count / perUs) : 0;
+  uint32_t min = s.count ? s.minTicks / perUs : 0;
+
+  int used = snprintf(buffer, size, "%-10s n=%lu min=%lu mean=%lu max=%lu us |",
+                      s.name, (unsigned long)s.count, (unsigned long)min, (unsigned long)mean,
+                      (unsigned long)(s.maxTicks / perUs));
+  for (uint8_t b = 0; b < PROFILER_BUCKETS && used > 0 && (size_t)used < size; b++) {
+    used += snprintf(buffer + used, size - used, " %lu", (unsigned long)s.histogram[b]);
+  }
+
+  return used < 0 ? 0 : ((size_t)used < size ? used : size - 1);
+}
+
+size_t Profiler::summary(char *buffer, size_t size) const {
+  if (size == 0) {
+    return 0;
+  }
+
+  size_t used = 0;
+  buffer[0] = '\0';
+  uint32_t perUs = ticksPerMicrosecond();
+  for (uint8_t i = 0; i < count; i++) {
+    const ProfilerSection &s = sections[i];
+    uint32_t mean = s.count ? (uint32_t)(s.totalTicks / s.count / perUs) : 0;
+    int n = snprintf(buffer + used, size - used, "%s%s %lu/%lu", i ? ";" : "", s.name,
+                     (unsigned long)mean, (unsigned long)(s.maxTicks / perUs));
+    if (n < 0 || used + n >= size) {
+      // Out of room: end on the last complete section
+      buffer[used] = '\0';
+      break;
+    }
+    used += n;
+  }
+
+  return used;
+}
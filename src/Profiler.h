@@ -0,0 +1,85 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Set to 0 to compile every PROFILE_SCOPE out of the firmware
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+#define PROFILER_MAX_SECTIONS 12
+#define PROFILER_BUCKETS 16         // Power-of-two microsecond buckets: <2us, <4us, ... >=16ms
+
+struct ProfilerSection
+{
+  const char *name;
+  uint32_t count;
+  uint32_t minTicks;
+  uint32_t maxTicks;
+  uint64_t totalTicks;
+  uint32_t histogram[PROFILER_BUCKETS];
+};
+
+// Timing of named code sections. On the Photon the clock is the DWT cycle counter
+// (System.ticks(), 120 per microsecond), on other Arduino cores micros(), and on a host
+// std::chrono, so the same instrumented code can be profiled anywhere.
+class Profiler
+{
+public:
+  Profiler();
+
+  // Find or register a section. Returns NULL once all PROFILER_MAX_SECTIONS are taken.
+  ProfilerSection *section(const char *name);
+
+  static uint32_t ticks();
+  static uint32_t ticksPerMicrosecond();
+
+  void record(ProfilerSection *section, uint32_t elapsedTicks);
+  void reset();
+
+  uint8_t sectionCount() const;
+
+  // One line per section: count, min/mean/max in microseconds and the histogram
+  size_t format(uint8_t index, char *buffer, size_t size) const;
+
+  // Compact "name mean/max;..." in microseconds, e.g. for a cloud variable
+  size_t summary(char *buffer, size_t size) const;
+
+private:
+  ProfilerSection sections[PROFILER_MAX_SECTIONS];
+  uint8_t count;
+};
+
+extern Profiler profiler;
+
+// Times the enclosing block for as long as it is in scope
+class ProfileScope
+{
+public:
+  ProfileScope(ProfilerSection *section) : section(section), start(Profiler::ticks()) {}
+  ~ProfileScope() {
+    if (section != NULL) {
+      profiler.record(section, Profiler::ticks() - start);
+    }
+  }
+
+private:
+  ProfilerSection *section;
+  uint32_t start;
+};
+
+#define PROFILER_CONCAT2(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT2(a, b)
+
+#if PROFILER_ENABLED
+// The section lookup only happens the first time through
+#define PROFILE_SCOPE(name) \
+  static ProfilerSection *PROFILER_CONCAT(profileSection, __LINE__) = profiler.section(name); \
+  ProfileScope PROFILER_CONCAT(profileScope, __LINE__)(PROFILER_CONCAT(profileSection, __LINE__))
+#else
+#define PROFILE_SCOPE(name) do {} while (0)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,258 @@
+#include "PublishQueue.h"
+
+#include <string.h>
+
+// Raw bytes that still fit in a full payload once base64 encoded
+#define PUBLISH_MAX_BINARY (PUBLISH_MAX_PAYLOAD / 4 * 3)
+
+static const char BASE64_CHARS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static size_t putVarint(uint8_t *out, uint32_t value) {
+  size_t length = 0;
+  while (value >= 0x80) {
+    out[length++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  out[length++] = value;
+  return length;
+}
+
+static bool getVarint(const uint8_t *in, size_t size, size_t &offset, uint32_t &value) {
+  value = 0;
+  for (uint8_t shift = 0; shift < 35 && offset < size; shift += 7) {
+    uint8_t byte = in[offset++];
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static size_t base64Encode(const uint8_t *in, size_t length, char *out) {
+  size_t used = 0;
+  for (size_t i = 0; i < length; i += 3) {
+    uint32_t block = (uint32_t)in[i] << 16;
+    if (i + 1 < length) {
+      block |= (uint32_t)in[i + 1] << 8;
+    }
+    if (i + 2 < length) {
+      block |= in[i + 2];
+    }
+
+    out[used++] = BASE64_CHARS[(block >> 18) & 0x3F];
+    out[used++] = BASE64_CHARS[(block >> 12) & 0x3F];
+    out[used++] = i + 1 < length ? BASE64_CHARS[(block >> 6) & 0x3F] : '=';
+    out[used++] = i + 2 < length ? BASE64_CHARS[block & 0x3F] : '=';
+  }
+  out[used] = '\0';
+  return used;
+}
+
+static size_t base64Decode(const char *in, uint8_t *out, size_t size) {
+  size_t used = 0;
+  uint32_t block = 0;
+  uint8_t bits = 0;
+  for (; *in && *in != '='; in++) {
+    const char *found = strchr(BASE64_CHARS, *in);
+    if (found == NULL) {
+      return 0;
+    }
+
+    block = (block << 6) | (found - BASE64_CHARS);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      if (used == size) {
+        return 0;
+      }
+      out[used++] = block >> bits;
+    }
+  }
+  return used;
+}
+
+PublishQueue::PublishQueue(PublishStore &store) :
+  store(store)
+{
+}
+
+void PublishQueue::begin() {
+  if (store.magic != PUBLISH_STORE_MAGIC || store.head >= PUBLISH_QUEUE_SLOTS ||
+      store.count > PUBLISH_QUEUE_SLOTS || store.check != checksum()) {
+    memset(&store, 0, sizeof(store));
+    store.magic = PUBLISH_STORE_MAGIC;
+  }
+
+  // Whatever was in flight before the reset will never be confirmed
+  store.inFlight = 0;
+  seal();
+}
+
+void PublishQueue::push(const PublishRecord &record) {
+  if (store.count == PUBLISH_QUEUE_SLOTS) {
+    store.head = (store.head + 1) % PUBLISH_QUEUE_SLOTS;
+    store.count--;
+    store.dropped++;
+    if (store.inFlight) {
+      store.inFlight--;
+    }
+  }
+
+  store.records[(store.head + store.count) % PUBLISH_QUEUE_SLOTS] = record;
+  store.count++;
+  seal();
+}
+
+uint8_t PublishQueue::pending() const {
+  return store.count;
+}
+
+uint8_t PublishQueue::inFlight() const {
+  return store.inFlight;
+}
+
+uint32_t PublishQueue::dropped() const {
+  return store.dropped;
+}
+
+uint8_t PublishQueue::flush(PublishSink sink) {
+  if (store.count == 0 || store.inFlight) {
+    return 0;
+  }
+
+  char payload[PUBLISH_MAX_PAYLOAD + 1];
+  uint8_t records = encode(payload, sizeof(payload), store.count);
+  if (records == 0 || !sink(payload)) {
+    return 0;
+  }
+
+  store.inFlight = records;
+  seal();
+  return records;
+}
+
+void PublishQueue::delivered() {
+  store.head = (store.head + store.inFlight) % PUBLISH_QUEUE_SLOTS;
+  store.count -= store.inFlight;
+  store.inFlight = 0;
+  seal();
+}
+
+void PublishQueue::undelivered() {
+  store.inFlight = 0;
+  seal();
+}
+
+void PublishQueue::clear() {
+  store.head = 0;
+  store.count = 0;
+  store.inFlight = 0;
+  seal();
+}
+
+uint8_t PublishQueue::encode(char *payload, size_t size, uint8_t maxRecords) const {
+  uint8_t binary[PUBLISH_MAX_BINARY];
+  size_t limit = (size - 1) / 4 * 3;
+  if (limit > sizeof(binary)) {
+    limit = sizeof(binary);
+  }
+  if (limit < 2) {
+    return 0;
+  }
+
+  size_t used = 2;
+  uint8_t records = 0;
+  uint32_t previous = 0;
+  if (maxRecords > store.count) {
+    maxRecords = store.count;
+  }
+
+  for (; records < maxRecords; records++) {
+    const PublishRecord &record = store.records[(store.head + records) % PUBLISH_QUEUE_SLOTS];
+
+    // Worst case is 5 bytes of timestamp and 3 per 16-bit field
+    uint8_t packed[20];
+    size_t length = 0;
+    if (records == 0) {
+      for (uint8_t i = 0; i < 4; i++) {
+        packed[length++] = record.timestamp >> (8 * i);
+      }
+    } else {
+      int32_t delta = (int32_t)(record.timestamp - previous);
+      length += putVarint(&packed[length], ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+    }
+    length += putVarint(&packed[length], record.maxPPM);
+    length += putVarint(&packed[length], record.avgPPM);
+    length += putVarint(&packed[length], record.maxBAC);
+    length += putVarint(&packed[length], record.avgBAC);
+    length += putVarint(&packed[length], record.duration);
+
+    if (used + length > limit) {
+      break;
+    }
+    memcpy(&binary[used], packed, length);
+    used += length;
+    previous = record.timestamp;
+  }
+
+  binary[0] = PUBLISH_FORMAT_VERSION;
+  binary[1] = records;
+  base64Encode(binary, used, payload);
+  return records;
+}
+
+uint8_t PublishQueue::decode(const char *payload, PublishRecord *records, uint8_t maxRecords) {
+  uint8_t binary[PUBLISH_MAX_BINARY];
+  size_t size = base64Decode(payload, binary, sizeof(binary));
+  if (size < 2 || binary[0] != PUBLISH_FORMAT_VERSION) {
+    return 0;
+  }
+
+  size_t offset = 2;
+  uint32_t previous = 0;
+  uint8_t count = binary[1] < maxRecords ? binary[1] : maxRecords;
+  for (uint8_t i = 0; i < count; i++) {
+    PublishRecord &record = records[i];
+    uint32_t value;
+
+    if (i == 0) {
+      if (size < offset + 4) {
+        return 0;
+      }
+      record.timestamp = binary[offset] | (binary[offset + 1] << 8) | (binary[offset + 2] << 16) | ((uint32_t)binary[offset + 3] << 24);
+      offset += 4;
+    } else {
+      if (!getVarint(binary, size, offset, value)) {
+        return i;
+      }
+      record.timestamp = previous + (uint32_t)((int32_t)(value >> 1) ^ -(int32_t)(value & 1));
+    }
+    previous = record.timestamp;
+
+    uint16_t *fields[] = { &record.maxPPM, &record.avgPPM, &record.maxBAC, &record.avgBAC, &record.duration };
+    for (uint8_t f = 0; f < 5; f++) {
+      if (!getVarint(binary, size, offset, value)) {
+        return i;
+      }
+      *fields[f] = value;
+    }
+  }
+
+  return count;
+}
+
+// Cheap sum over the store, so a store that lost power halfway through an update or was never
+// initialised is recognised in begin()
+uint32_t PublishQueue::checksum() const {
+  const uint8_t *bytes = (const uint8_t *)&store;
+  uint32_t sum = 0x12345678;
+  for (size_t i = 0; i < offsetof(PublishStore, check); i++) {
+    sum = (sum << 5) + (sum >> 27) + bytes[i];
+  }
+  return sum;
+}
+
+void PublishQueue::seal() {
+  store.check = checksum();
+}
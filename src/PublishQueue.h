@@ -0,0 +1,92 @@
+#ifndef PUBLISH_QUEUE_H
+#define PUBLISH_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PUBLISH_QUEUE_SLOTS 32
+#define PUBLISH_MAX_PAYLOAD 622         // Photon limit on event data
+#define PUBLISH_FORMAT_VERSION 1
+#define PUBLISH_STORE_MAGIC 0x42524551  // "BREQ"
+
+// One breath result as it goes to the cloud
+struct PublishRecord
+{
+  uint32_t timestamp;   // Unix time, 0 if the clock wasn't synced yet
+  uint16_t maxPPM;
+  uint16_t avgPPM;
+  uint16_t maxBAC;      // In millionths, i.e. BAC * 1e6
+  uint16_t avgBAC;
+  uint16_t duration;    // Length of the reading in tenths of a second
+};
+
+// Backing storage for the queue. Plain data so it can live in retained (backup) RAM and
+// survive a reset or a cloud outage; PublishQueue::begin() checks it is still intact.
+struct PublishStore
+{
+  uint32_t magic;
+  uint8_t head;
+  uint8_t count;
+  uint8_t inFlight;     // Oldest 'inFlight' records were handed to the cloud and not confirmed yet
+  uint8_t reserved;
+  uint32_t dropped;
+  PublishRecord records[PUBLISH_QUEUE_SLOTS];
+  uint32_t check;
+};
+
+typedef bool (*PublishSink)(const char *payload);
+
+// Store-and-forward queue of breath results. Results pile up while the cloud can't be reached;
+// flush() packs as many as fit into one event. The event data is base64 of:
+//
+//   version u8 | count u8 | records...
+//
+// where each record is the timestamp (u32 little endian for the first record, after that a
+// zigzag varint delta from the previous one) followed by varints of maxPPM, avgPPM, maxBAC,
+// avgBAC and duration. A typical result packs into 12-14 bytes, about 20 once base64 encoded.
+//
+// One event is out at a time: flush() only marks what it sent as in flight, and the results
+// stay queued until delivered() says the send went through or undelivered() puts them back up
+// for the next flush(). A reset forgets what was in flight, so those go again; receivers
+// should drop results whose timestamp they already have.
+class PublishQueue
+{
+public:
+  PublishQueue(PublishStore &store);
+
+  // Keep what survived a reset, or start empty if the store doesn't look valid
+  void begin();
+
+  // Queue a result. When full, the oldest result is dropped to make room.
+  void push(const PublishRecord &record);
+
+  // Queued results, including any in flight
+  uint8_t pending() const;
+  uint8_t inFlight() const;
+  uint32_t dropped() const;
+
+  // Encode as many of the oldest results as fit in one event and hand it to the sink, unless an
+  // event is already in flight. If the sink takes it, they are in flight. Returns how many.
+  uint8_t flush(PublishSink sink);
+
+  // The event in flight arrived, so its results can go; or it didn't, so they are sent again
+  void delivered();
+  void undelivered();
+
+  // Drop every queued result, the ones in flight included; whatever comes of that send is ignored
+  void clear();
+
+  // Encode up to maxRecords of the oldest results into 'payload'. Returns how many made it.
+  uint8_t encode(char *payload, size_t size, uint8_t maxRecords) const;
+
+  // Unpack an event payload, e.g. on the receiving side. Returns how many records it held.
+  static uint8_t decode(const char *payload, PublishRecord *records, uint8_t maxRecords);
+
+private:
+  void seal();
+  uint32_t checksum() const;
+
+  PublishStore &store;
+};
+
+#endif // PUBLISH_QUEUE_H
@@ -0,0 +1,208 @@
+#ifndef SAMPLE_FILTERS_H
+#define SAMPLE_FILTERS_H
+
+#include <stdint.h>
+
+// Integer filter stages for the raw MQ3 stream, chained at compile time with Pipeline<...>.
+// Every stage has the same shape:
+//   bool process(int32_t in, int32_t &out)   false if this input produced no output (decimation)
+//   void reset()
+// Nothing allocates; each stage only holds the state it needs.
+
+// Median of the last three samples. Knocks out single-sample spikes without smearing steps.
+class Median3
+{
+public:
+  Median3() {
+    reset();
+  }
+
+  void reset() {
+    a = 0;
+    b = 0;
+    primed = false;
+  }
+
+  bool process(int32_t in, int32_t &out) {
+    if (!primed) {
+      a = b = in;
+      primed = true;
+    }
+
+    int32_t c = in;
+    int32_t lo = a < b ? a : b;
+    int32_t hi = a < b ? b : a;
+    out = c < lo ? lo : (c > hi ? hi : c);
+
+    a = b;
+    b = c;
+    return true;
+  }
+
+private:
+  int32_t a;
+  int32_t b;
+  bool primed;
+};
+
+// Single-pole low-pass, y += alpha * (x - y), with alpha in Q15 (e.g. 8192 = 0.25).
+// The state carries 16 extra fraction bits so small alphas don't stall on rounding.
+template <int32_t ALPHA_Q15>
+class IIRLowPass
+{
+  static_assert(ALPHA_Q15 > 0 && ALPHA_Q15 <= 32768, "ALPHA_Q15 must be in (0, 1]");
+
+public:
+  IIRLowPass() {
+    reset();
+  }
+
+  void reset() {
+    state = 0;
+    primed = false;
+  }
+
+  bool process(int32_t in, int32_t &out) {
+    int64_t x = (int64_t)in << 16;
+    if (!primed) {
+      state = x;
+      primed = true;
+    } else {
+      state += ((x - state) * ALPHA_Q15) >> 15;
+    }
+
+    out = (int32_t)((state + (1 << 15)) >> 16);
+    return true;
+  }
+
+private:
+  int64_t state;
+  bool primed;
+};
+
+// FIR with Q15 taps given as template arguments, e.g. FIR<8192, 16384, 8192>.
+// The output is rounded; taps should sum to 32768 for unity gain.
+template <int16_t... TAPS_Q15>
+class FIR
+{
+  static const uint8_t TAP_COUNT = sizeof...(TAPS_Q15);
+  static_assert(TAP_COUNT > 0, "FIR needs at least one tap");
+
+public:
+  FIR() {
+    reset();
+  }
+
+  void reset() {
+    primed = false;
+    next = 0;
+  }
+
+  bool process(int32_t in, int32_t &out) {
+    static const int16_t TAPS[TAP_COUNT] = { TAPS_Q15... };
+
+    if (!primed) {
+      // Start from a steady state at the first sample instead of ramping up from zero
+      for (uint8_t i = 0; i < TAP_COUNT; i++) {
+        history[i] = in;
+      }
+      primed = true;
+    }
+    history[next] = in;
+
+    // TAPS[0] applies to the newest sample
+    int32_t acc = 1 << 14;
+    uint8_t index = next;
+    for (uint8_t i = 0; i < TAP_COUNT; i++) {
+      acc += history[index] * TAPS[i];
+      index = index == 0 ? TAP_COUNT - 1 : index - 1;
+    }
+    next = next + 1 == TAP_COUNT ? 0 : next + 1;
+
+    out = acc >> 15;
+    return true;
+  }
+
+private:
+  int32_t history[TAP_COUNT];
+  uint8_t next;
+  bool primed;
+};
+
+// Averages each block of N inputs into one rounded output (boxcar FIR + decimate by N)
+template <uint16_t N>
+class Decimate
+{
+  static_assert(N > 0, "N must be at least 1");
+
+public:
+  Decimate() {
+    reset();
+  }
+
+  void reset() {
+    total = 0;
+    count = 0;
+  }
+
+  bool process(int32_t in, int32_t &out) {
+    total += in;
+    if (++count < N) {
+      return false;
+    }
+
+    out = (total + (int32_t)(N / 2)) / (int32_t)N;
+    total = 0;
+    count = 0;
+    return true;
+  }
+
+private:
+  int32_t total;
+  uint16_t count;
+};
+
+// Runs a sample through each stage in order, stopping as soon as one produces nothing
+template <typename... STAGES>
+class Pipeline;
+
+template <>
+class Pipeline<>
+{
+public:
+  void reset() {}
+
+  bool process(int32_t in, int32_t &out) {
+    out = in;
+    return true;
+  }
+};
+
+template <typename FIRST, typename... REST>
+class Pipeline<FIRST, REST...>
+{
+public:
+  void reset() {
+    first.reset();
+    rest.reset();
+  }
+
+  bool process(int32_t in, int32_t &out) {
+    int32_t value;
+    return first.process(in, value) && rest.process(value, out);
+  }
+
+  FIRST &head() {
+    return first;
+  }
+
+  Pipeline<REST...> &tail() {
+    return rest;
+  }
+
+private:
+  FIRST first;
+  Pipeline<REST...> rest;
+};
+
+#endif // SAMPLE_FILTERS_H
@@ -0,0 +1,81 @@
+#ifndef SAMPLE_RING_BUFFER_H
+#define SAMPLE_RING_BUFFER_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Single-producer/single-consumer lock-free ring buffer.
+// The producer (a timer callback or ISR) only ever writes head, the consumer (loop()) only ever writes tail,
+// so no locking or interrupt masking is needed on either side. CAPACITY must be a power of two.
+template <typename T, uint16_t CAPACITY>
+class SampleRingBuffer
+{
+  static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+public:
+  SampleRingBuffer() : head(0), tail(0), overflows(0) {}
+
+  // Producer side. Returns false and counts an overflow if the consumer has fallen behind.
+  bool push(const T &value) {
+    uint16_t h = head.load(std::memory_order_relaxed);
+    if ((uint16_t)(h - tail.load(std::memory_order_acquire)) >= CAPACITY) {
+      overflows.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    items[h & MASK] = value;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Copies up to maxCount items into out and returns how many were copied.
+  uint16_t popBatch(T *out, uint16_t maxCount) {
+    uint16_t t = tail.load(std::memory_order_relaxed);
+    uint16_t count = head.load(std::memory_order_acquire) - t;
+    if (count > maxCount) {
+      count = maxCount;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+      out[i] = items[(t + i) & MASK];
+    }
+
+    tail.store(t + count, std::memory_order_release);
+    return count;
+  }
+
+  bool pop(T &out) {
+    return popBatch(&out, 1) == 1;
+  }
+
+  // Consumer side. Throws away everything that is currently queued.
+  void clear() {
+    tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+  }
+
+  uint16_t size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  uint32_t overflowCount() const {
+    return overflows.load(std::memory_order_relaxed);
+  }
+
+  static uint16_t capacity() {
+    return CAPACITY;
+  }
+
+private:
+  static const uint16_t MASK = CAPACITY - 1;
+
+  T items[CAPACITY];
+  std::atomic<uint16_t> head;
+  std::atomic<uint16_t> tail;
+  std::atomic<uint32_t> overflows;
+};
+
+#endif // SAMPLE_RING_BUFFER_H
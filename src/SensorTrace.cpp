@@ -0,0 +1,331 @@
+#include "SensorTrace.h"
+
+#include <string.h>
+
+#include "Crc8.h"
+
+static uint16_t get16(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+TraceRecorder::TraceRecorder(TraceSink sink) :
+  sink(sink), enabled(false), length(0)
+{
+}
+
+void TraceRecorder::setEnabled(bool enabled) {
+  this->enabled = enabled;
+}
+
+bool TraceRecorder::isEnabled() const {
+  return enabled;
+}
+
+void TraceRecorder::header(uint16_t samplePeriodMs, int32_t baselinePPM) {
+  if (!enabled) {
+    return;
+  }
+
+  begin(TRACE_HEADER);
+  put8(TRACE_VERSION);
+  put16(samplePeriodMs);
+  put32(baselinePPM);
+  end();
+}
+
+void TraceRecorder::samples(uint32_t time, const uint16_t *values, uint16_t count) {
+  if (!enabled) {
+    return;
+  }
+
+  // Big batches go out as several frames with the same timestamp
+  while (count > 0) {
+    uint8_t chunk = count > TRACE_MAX_SAMPLES ? TRACE_MAX_SAMPLES : count;
+
+    begin(TRACE_SAMPLES);
+    put32(time);
+    put8(chunk);
+    for (uint8_t i = 0; i < chunk; i += 2) {
+      uint16_t a = values[i] & 0x0FFF;
+      uint16_t b = i + 1 < chunk ? values[i + 1] & 0x0FFF : 0;
+      put8(a);
+      put8((a >> 8) | (b << 4));
+      if (i + 1 < chunk) {
+        put8(b >> 4);
+      }
+    }
+    end();
+
+    values += chunk;
+    count -= chunk;
+  }
+}
+
+void TraceRecorder::button(uint32_t time, uint8_t level) {
+  if (!enabled) {
+    return;
+  }
+
+  begin(TRACE_BUTTON);
+  put32(time);
+  put8(level);
+  end();
+}
+
+void TraceRecorder::mode(uint32_t time, TraceMode mode) {
+  if (!enabled) {
+    return;
+  }
+
+  begin(TRACE_MODE);
+  put32(time);
+  put8(mode);
+  end();
+}
+
+void TraceRecorder::result(uint32_t time, int32_t maxPPM, int32_t avgPPM) {
+  if (!enabled) {
+    return;
+  }
+
+  begin(TRACE_RESULT);
+  put32(time);
+  put32(maxPPM);
+  put32(avgPPM);
+  end();
+}
+
+void TraceRecorder::begin(uint8_t type) {
+  frame[0] = TRACE_SYNC;
+  frame[1] = type;
+  length = 3;
+}
+
+void TraceRecorder::put8(uint8_t value) {
+  frame[length++] = value;
+}
+
+void TraceRecorder::put16(uint16_t value) {
+  put8(value);
+  put8(value >> 8);
+}
+
+void TraceRecorder::put32(uint32_t value) {
+  put16(value);
+  put16(value >> 16);
+}
+
+void TraceRecorder::end() {
+  frame[2] = length - 3;
+  frame[length] = crc8(&frame[1], length - 1);
+  sink(frame, length + 1);
+}
+
+TraceDecoder::TraceDecoder() :
+  length(0), bad(0)
+{
+  memset(&current, 0, sizeof(current));
+}
+
+bool TraceDecoder::push(uint8_t byte) {
+  if (length == 0 && byte != TRACE_SYNC) {
+    return false;
+  }
+
+  frame[length++] = byte;
+  if (length < 3) {
+    return false;
+  }
+  if (frame[2] > TRACE_MAX_PAYLOAD) {
+    bad++;
+    length = 0;
+    return false;
+  }
+  if (length < frame[2] + 4) {
+    return false;
+  }
+
+  length = 0;
+  if (crc8(&frame[1], frame[2] + 2) != frame[frame[2] + 3] || !decode()) {
+    // Corrupted, or cut short by a reset
+    bad++;
+    return false;
+  }
+  return true;
+}
+
+const TraceRecord &TraceDecoder::record() const {
+  return current;
+}
+
+uint32_t TraceDecoder::badFrames() const {
+  return bad;
+}
+
+bool TraceDecoder::decode() {
+  uint8_t type = frame[1];
+  uint8_t size = frame[2];
+  const uint8_t *p = &frame[3];
+
+  current.type = type;
+  switch (type) {
+    case TRACE_HEADER:
+      if (size != 7) {
+        return false;
+      }
+      current.time = 0;
+      current.header.version = p[0];
+      current.header.samplePeriodMs = get16(&p[1]);
+      current.header.baselinePPM = get32(&p[3]);
+      return true;
+    case TRACE_SAMPLES: {
+      uint8_t count = size >= 5 ? p[4] : 0;
+      if (size < 5 || count > TRACE_MAX_SAMPLES || size != 5 + (count * 3 + 1) / 2) {
+        return false;
+      }
+      current.time = get32(p);
+      current.samples.count = count;
+      const uint8_t *packed = &p[5];
+      for (uint8_t i = 0; i < count; i += 2) {
+        current.samples.values[i] = packed[0] | ((packed[1] & 0x0F) << 8);
+        if (i + 1 < count) {
+          current.samples.values[i + 1] = (packed[1] >> 4) | (packed[2] << 4);
+        }
+        packed += 3;
+      }
+      return true;
+    }
+    case TRACE_BUTTON:
+    case TRACE_MODE:
+      if (size != 5) {
+        return false;
+      }
+      current.time = get32(p);
+      current.level = p[4];   // shares storage with mode
+      return true;
+    case TRACE_RESULT:
+      if (size != 12) {
+        return false;
+      }
+      current.time = get32(p);
+      current.result.maxPPM = get32(&p[4]);
+      current.result.avgPPM = get32(&p[8]);
+      return true;
+    default:
+      return false;
+  }
+}
+
+TraceReplay::TraceReplay() :
+  baselinePPM(0), reading(false), resultPending(false),
+  readingStart(0), breathEnd(0), recordedMs(0), detectedMs(0),
+  warming(false), warmupStart(0), warmupMs(0), settledMs(0),
+  sampleCount(0), warmupCount(0), readingCount(0), matchCount(0), mismatchCount(0)
+{
+  memset(&last, 0, sizeof(last));
+}
+
+void TraceReplay::handle(const TraceRecord &record) {
+  switch (record.type) {
+    case TRACE_HEADER:
+      baselinePPM = record.header.baselinePPM;
+      break;
+    case TRACE_SAMPLES:
+      sampleCount += record.samples.count;
+      if (reading) {
+        session.addSamples(record.samples.values, record.samples.count);
+        if (breathEnd == 0 && session.breathFinished()) {
+          breathEnd = record.time;
+        }
+      }
+      if (warming) {
+        warmup.addSamples(record.samples.values, record.samples.count);
+        if (settledMs == 0 && warmup.stable()) {
+          settledMs = record.time - warmupStart;
+        }
+      }
+      break;
+    case TRACE_MODE:
+      if (warming) {
+        warmupMs = record.time - warmupStart;
+        warming = false;
+        warmupCount++;
+      }
+      if (record.mode == TRACE_MODE_WARMING_UP) {
+        warmup.reset();
+        warming = true;
+        warmupStart = record.time;
+        settledMs = 0;
+      } else if (record.mode == TRACE_MODE_READING) {
+        session.reset();
+        reading = true;
+        readingStart = record.time;
+        breathEnd = 0;
+      } else if (reading) {
+        last = session.finish(baselinePPM);
+        recordedMs += record.time - readingStart;
+        detectedMs += (breathEnd ? breathEnd : record.time) - readingStart;
+        reading = false;
+        resultPending = true;
+        readingCount++;
+      }
+      break;
+    case TRACE_RESULT:
+      // Only compare against a reading we saw from the start
+      if (resultPending) {
+        if (record.result.maxPPM == last.maxPPM && record.result.avgPPM == last.avgPPM) {
+          matchCount++;
+        } else {
+          mismatchCount++;
+        }
+        resultPending = false;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+uint32_t TraceReplay::samples() const {
+  return sampleCount;
+}
+
+uint16_t TraceReplay::readings() const {
+  return readingCount;
+}
+
+uint16_t TraceReplay::matches() const {
+  return matchCount;
+}
+
+uint16_t TraceReplay::mismatches() const {
+  return mismatchCount;
+}
+
+const BreathResult &TraceReplay::lastResult() const {
+  return last;
+}
+
+uint32_t TraceReplay::recordedReadingMs() const {
+  return recordedMs;
+}
+
+uint32_t TraceReplay::detectedReadingMs() const {
+  return detectedMs;
+}
+
+uint16_t TraceReplay::warmups() const {
+  return warmupCount;
+}
+
+uint32_t TraceReplay::lastWarmupMs() const {
+  return warmupMs;
+}
+
+uint32_t TraceReplay::lastSettledMs() const {
+  return settledMs;
+}
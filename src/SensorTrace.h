@@ -0,0 +1,154 @@
+#ifndef SENSOR_TRACE_H
+#define SENSOR_TRACE_H
+
+#include <stdint.h>
+#include "BreathSession.h"
+#include "WarmupMonitor.h"
+
+// Binary trace of what the firmware saw: raw MQ3 samples, button edges, mode changes and the
+// results it reported. Frames can be mixed into the same Serial stream as the text output:
+//
+//   0xA5 | type | length | payload[length] | crc8(type, length, payload)
+//
+// All multi-byte fields are little endian, times are millis(). Sample batches pack two 12-bit
+// ADC readings into three bytes. Decoding is Particle-free so traces can be replayed on a host.
+
+#define TRACE_SYNC 0xA5
+#define TRACE_VERSION 1
+#define TRACE_MAX_SAMPLES 32
+#define TRACE_MAX_PAYLOAD (5 + (TRACE_MAX_SAMPLES * 3 + 1) / 2)
+#define TRACE_MAX_FRAME (TRACE_MAX_PAYLOAD + 4)
+
+enum TraceRecordType
+{
+  TRACE_HEADER  = 'H',   // version u8, sample period u16, baseline PPM i32 (Q16.16)
+  TRACE_SAMPLES = 'S',   // time u32, count u8, packed samples
+  TRACE_BUTTON  = 'B',   // time u32, level u8
+  TRACE_MODE    = 'M',   // time u32, mode u8
+  TRACE_RESULT  = 'R'    // time u32, max PPM i32, avg PPM i32
+};
+
+enum TraceMode
+{
+  TRACE_MODE_WARMING_UP = 0,
+  TRACE_MODE_IDLE,
+  TRACE_MODE_READING,
+  TRACE_MODE_COOLDOWN
+};
+
+struct TraceRecord
+{
+  uint8_t type;
+  uint32_t time;
+  union
+  {
+    struct { uint8_t version; uint16_t samplePeriodMs; int32_t baselinePPM; } header;
+    struct { uint8_t count; uint16_t values[TRACE_MAX_SAMPLES]; } samples;
+    uint8_t level;
+    uint8_t mode;
+    struct { int32_t maxPPM; int32_t avgPPM; } result;
+  };
+};
+
+typedef void (*TraceSink)(const uint8_t *data, uint16_t length);
+
+// Builds frames and hands them to the sink (e.g. Serial.write) while enabled
+class TraceRecorder
+{
+public:
+  TraceRecorder(TraceSink sink);
+
+  void setEnabled(bool enabled);
+  bool isEnabled() const;
+
+  void header(uint16_t samplePeriodMs, int32_t baselinePPM);
+  void samples(uint32_t time, const uint16_t *values, uint16_t count);
+  void button(uint32_t time, uint8_t level);
+  void mode(uint32_t time, TraceMode mode);
+  void result(uint32_t time, int32_t maxPPM, int32_t avgPPM);
+
+private:
+  void begin(uint8_t type);
+  void put8(uint8_t value);
+  void put16(uint16_t value);
+  void put32(uint32_t value);
+  void end();
+
+  TraceSink sink;
+  bool enabled;
+  uint8_t frame[TRACE_MAX_FRAME];
+  uint8_t length;
+};
+
+// Pulls frames back out of a byte stream. Bytes outside of valid frames (text output, line
+// noise, a frame cut off by a reset) are skipped.
+class TraceDecoder
+{
+public:
+  TraceDecoder();
+
+  // Returns true when 'byte' completed a valid frame, which is then available from record()
+  bool push(uint8_t byte);
+  const TraceRecord &record() const;
+
+  uint32_t badFrames() const;
+
+private:
+  bool decode();
+
+  uint8_t frame[TRACE_MAX_FRAME];
+  uint8_t length;
+  uint32_t bad;
+  TraceRecord current;
+};
+
+// Runs decoded records back through the READING/COOLDOWN logic and checks the results against
+// the ones the device reported. Also measures how long readings take with breath detection, and
+// when WarmupMonitor would have ended each warm-up.
+class TraceReplay
+{
+public:
+  TraceReplay();
+
+  void handle(const TraceRecord &record);
+
+  uint32_t samples() const;
+  uint16_t readings() const;
+  uint16_t matches() const;
+  uint16_t mismatches() const;
+  const BreathResult &lastResult() const;
+
+  // Total READING time in the trace, and what it would have been had each reading stopped as
+  // soon as the breath detector saw the plateau
+  uint32_t recordedReadingMs() const;
+  uint32_t detectedReadingMs() const;
+
+  // The last WARMING_UP as recorded, and how far into it WarmupMonitor first called the sensor
+  // stable (0 if it never did)
+  uint16_t warmups() const;
+  uint32_t lastWarmupMs() const;
+  uint32_t lastSettledMs() const;
+
+private:
+  BreathSession session;
+  WarmupMonitor warmup;
+  BreathResult last;
+  int32_t baselinePPM;
+  bool reading;
+  bool resultPending;
+  uint32_t readingStart;
+  uint32_t breathEnd;
+  uint32_t recordedMs;
+  uint32_t detectedMs;
+  bool warming;
+  uint32_t warmupStart;
+  uint32_t warmupMs;
+  uint32_t settledMs;
+  uint32_t sampleCount;
+  uint16_t warmupCount;
+  uint16_t readingCount;
+  uint16_t matchCount;
+  uint16_t mismatchCount;
+};
+
+#endif // SENSOR_TRACE_H
@@ -0,0 +1,171 @@
+#include "SessionLog.h"
+
+#include <stddef.h>
+
+#include "Crc8.h"
+
+#define COMMIT_OFFSET offsetof(SessionLogRecord, commit)
+
+SessionLog::SessionLog(StorageRead read, StorageWrite write, uint16_t address, uint8_t slots) :
+  read(read),
+  write(write),
+  address(address),
+  slots(slots < SESSION_LOG_SLOTS ? slots : SESSION_LOG_SLOTS),
+  head(0),
+  records(0),
+  sequence(0)
+{
+}
+
+uint8_t SessionLog::begin() {
+  head = 0;
+  records = 0;
+  sequence = 0;
+
+  // The newest record is the valid one with the highest sequence
+  SessionLogRecord record;
+  uint8_t newest = 0;
+  for (uint8_t slot = 0; slot < slots; slot++) {
+    if (readSlot(slot, record) && record.sequence > sequence) {
+      sequence = record.sequence;
+      newest = slot;
+    }
+  }
+  if (sequence == 0) {
+    return 0;
+  }
+
+  // Walk back from it for as long as the sequence numbers follow on. Anything older than
+  // a gap can't be placed in order, so it is left to be overwritten.
+  uint8_t slot = newest;
+  uint32_t expected = sequence;
+  while (records < slots && readSlot(slot, record) && record.sequence == expected) {
+    timeIndex[slot] = record.timestamp;
+    setUnsynced(slot, record.timestamp == 0);
+    records++;
+    expected--;
+    slot = slot == 0 ? slots - 1 : slot - 1;
+  }
+  head = (newest + 1) % slots;
+
+  // Carry timestamps forward over unsynced records so the index can be binary searched
+  for (uint8_t n = 1; n < records; n++) {
+    if (timeIndex[slotOf(n)] < timeIndex[slotOf(n - 1)]) {
+      timeIndex[slotOf(n)] = timeIndex[slotOf(n - 1)];
+    }
+  }
+
+  return records;
+}
+
+uint32_t SessionLog::append(const SessionLogRecord &record) {
+  SessionLogRecord stored = record;
+  stored.sequence = ++sequence;
+  stored.crc = crc(stored);
+  stored.commit = SESSION_COMMIT_MARKER;
+
+  uint16_t slotStart = slotAddress(head);
+  uint8_t cleared = 0;
+  write(slotStart + COMMIT_OFFSET, &cleared, 1);
+  write(slotStart, (const uint8_t *)&stored, COMMIT_OFFSET);
+  write(slotStart + COMMIT_OFFSET, &stored.commit, 1);
+
+  uint32_t time = record.timestamp;
+  if (records > 0 && time < timeIndex[slotOf(records - 1)]) {
+    time = timeIndex[slotOf(records - 1)];
+  }
+  timeIndex[head] = time;
+  setUnsynced(head, record.timestamp == 0);
+
+  head = (head + 1) % slots;
+  if (records < slots) {
+    records++;
+  }
+  return sequence;
+}
+
+uint8_t SessionLog::count() const {
+  return records;
+}
+
+uint8_t SessionLog::capacity() const {
+  return slots;
+}
+
+uint32_t SessionLog::lastSequence() const {
+  return sequence;
+}
+
+bool SessionLog::get(uint8_t n, SessionLogRecord &record) const {
+  return n < records && readSlot(slotOf(n), record);
+}
+
+uint8_t SessionLog::find(uint32_t time) const {
+  uint8_t low = 0;
+  uint8_t high = records;
+  while (low < high) {
+    uint8_t middle = (low + high) / 2;
+    if (timeIndex[slotOf(middle)] < time) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+bool SessionLog::inRange(uint8_t n, uint32_t from, uint32_t to) const {
+  if (n >= records) {
+    return false;
+  }
+  uint8_t slot = slotOf(n);
+  bool synced = !(unsynced[slot / 8] & (1 << (slot % 8)));
+  return timeIndex[slot] >= from && timeIndex[slot] <= to && (synced || from == 0);
+}
+
+uint8_t SessionLog::query(uint32_t from, uint32_t to, SessionVisitor visitor) const {
+  uint8_t visited = 0;
+  SessionLogRecord record;
+  for (uint8_t n = find(from); n < records && timeIndex[slotOf(n)] <= to; n++) {
+    if (inRange(n, from, to) && readSlot(slotOf(n), record)) {
+      visitor(record);
+      visited++;
+    }
+  }
+  return visited;
+}
+
+uint8_t SessionLog::count(uint32_t from, uint32_t to) const {
+  uint8_t counted = 0;
+  for (uint8_t n = find(from); n < records && timeIndex[slotOf(n)] <= to; n++) {
+    counted += inRange(n, from, to);
+  }
+  return counted;
+}
+
+uint16_t SessionLog::slotAddress(uint8_t slot) const {
+  return address + slot * sizeof(SessionLogRecord);
+}
+
+void SessionLog::setUnsynced(uint8_t slot, bool isUnsynced) {
+  if (isUnsynced) {
+    unsynced[slot / 8] |= 1 << (slot % 8);
+  } else {
+    unsynced[slot / 8] &= ~(1 << (slot % 8));
+  }
+}
+
+// Slot holding the n-th oldest record
+uint8_t SessionLog::slotOf(uint8_t n) const {
+  return (head + slots - records + n) % slots;
+}
+
+bool SessionLog::readSlot(uint8_t slot, SessionLogRecord &record) const {
+  read(slotAddress(slot), (uint8_t *)&record, sizeof(record));
+  return record.commit == SESSION_COMMIT_MARKER && record.crc == crc(record);
+}
+
+// CRC-8 over the record up to the crc byte
+uint8_t SessionLog::crc(const SessionLogRecord &record) {
+  return crc8((const uint8_t *)&record, offsetof(SessionLogRecord, crc));
+}
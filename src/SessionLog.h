@@ -0,0 +1,75 @@
+#ifndef SESSION_LOG_H
+#define SESSION_LOG_H
+
+#include <stdint.h>
+
+#include "EepromLayout.h"
+
+typedef void (*StorageRead)(uint16_t address, uint8_t *data, uint16_t length);
+typedef void (*StorageWrite)(uint16_t address, const uint8_t *data, uint16_t length);
+typedef void (*SessionVisitor)(const SessionLogRecord &record);
+
+// Append-only history of breath results in a circular run of EEPROM slots. Once the log is full
+// each new result replaces the oldest, so writes go round all the slots evenly.
+//
+// An append first clears the commit byte of the slot it is about to reuse, then writes the record,
+// then sets the commit byte. A reset at any point leaves at most that one slot unreadable, and
+// begin() picks the log up again from the valid slot with the highest sequence number.
+//
+// Timestamps are kept in RAM per slot, so a time-range query is a binary search plus reading
+// only the slots it returns. Storage is reached through two callbacks, so the same code runs
+// on EEPROM on the device and on a file on a PC.
+class SessionLog
+{
+public:
+  SessionLog(StorageRead read, StorageWrite write,
+             uint16_t address = EEPROM_SESSION_LOG_ADDRESS, uint8_t slots = SESSION_LOG_SLOTS);
+
+  // Scan the slots and rebuild the index. Returns how many records were found.
+  uint8_t begin();
+
+  // Sequence, crc and commit are filled in here. Returns the sequence number given.
+  uint32_t append(const SessionLogRecord &record);
+
+  uint8_t count() const;
+  uint8_t capacity() const;
+  uint32_t lastSequence() const;
+
+  // The n-th oldest record. False if there is no such record or its slot no longer checks out.
+  bool get(uint8_t n, SessionLogRecord &record) const;
+
+  // Position of the oldest record stamped at or after 'time'
+  uint8_t find(uint32_t time) const;
+
+  // Whether the n-th oldest record is within [from, to], going by the time index alone. Records
+  // made before the clock was synced (timestamp 0) are only included when 'from' is 0, and one
+  // stamped earlier than the record before it (the clock was set back) counts as at that time.
+  bool inRange(uint8_t n, uint32_t from, uint32_t to) const;
+
+  // Visit the records inRange(), oldest first. Returns how many were visited.
+  uint8_t query(uint32_t from, uint32_t to, SessionVisitor visitor) const;
+
+  // How many records are inRange(), without reading them. Only differs from what query()
+  // visits if a slot no longer checks out, which query() skips.
+  uint8_t count(uint32_t from, uint32_t to) const;
+
+private:
+  uint16_t slotAddress(uint8_t slot) const;
+  void setUnsynced(uint8_t slot, bool isUnsynced);
+  uint8_t slotOf(uint8_t n) const;
+  bool readSlot(uint8_t slot, SessionLogRecord &record) const;
+
+  static uint8_t crc(const SessionLogRecord &record);
+
+  StorageRead read;
+  StorageWrite write;
+  uint16_t address;
+  uint8_t slots;
+  uint8_t head;         // Slot the next append goes to
+  uint8_t records;
+  uint32_t sequence;    // Of the newest record
+  uint32_t timeIndex[SESSION_LOG_SLOTS];  // Per slot; never decreases from oldest to newest
+  uint8_t unsynced[(SESSION_LOG_SLOTS + 7) / 8];  // Per slot, set if the record's timestamp is 0
+};
+
+#endif // SESSION_LOG_H
@@ -0,0 +1,131 @@
+#ifndef STATE_MACHINE_H
+#define STATE_MACHINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define STATE_NONE 0xFF
+#define STATE_EVENT_QUEUE 4   // Events raised from inside a transition, handled once it completes
+
+typedef void (*StateAction)();
+typedef bool (*StateGuard)();
+typedef void (*StateObserver)(uint8_t from, uint8_t event, uint8_t to);
+
+// What a state does: enter and exit run on every transition into or out of it, update is its
+// ongoing work (called through StateMachine::update()). Any of them may be NULL.
+struct StateDefinition
+{
+  StateAction enter;
+  StateAction exit;
+  StateAction update;
+};
+
+// What an event does in one state. target STATE_NONE means the event is ignored there;
+// otherwise the transition is taken if there is no guard or the guard returns true.
+struct StateTransition
+{
+  uint8_t target;
+  StateGuard guard;
+  StateAction action;   // Runs between the old state's exit and the new state's enter
+};
+
+// Table-driven state machine. The states and transitions are const tables indexed by state and
+// [state][event], so they stay in flash and dispatching an event is one lookup, not a search.
+// Transitions run to completion: an event raised by an action while a transition is under way
+// is queued and handled right after it.
+template <uint8_t STATES, uint8_t EVENTS>
+class StateMachine
+{
+public:
+  typedef StateTransition TransitionTable[STATES][EVENTS];
+
+  StateMachine(const StateDefinition (&states)[STATES], const TransitionTable &transitions,
+               StateObserver observer = NULL) :
+    states(states), transitions(transitions), observer(observer),
+    current(STATE_NONE), dispatching(false), queued(0), taken(0)
+  {
+  }
+
+  // Enter the first state
+  void start(uint8_t initial) {
+    current = initial;
+    run(states[current].enter);
+  }
+
+  // Returns true if the event caused a transition, or was queued behind the one running now
+  bool dispatch(uint8_t event) {
+    if (event >= EVENTS || current == STATE_NONE) {
+      return false;
+    }
+
+    if (dispatching) {
+      if (queued == STATE_EVENT_QUEUE) {
+        return false;
+      }
+      queue[queued++] = event;
+      return true;
+    }
+
+    dispatching = true;
+    bool changed = take(event);
+    for (uint8_t i = 0; i < queued; i++) {
+      take(queue[i]);   // May queue more behind it, which this loop then picks up
+    }
+    queued = 0;
+    dispatching = false;
+    return changed;
+  }
+
+  // Run the current state's ongoing work
+  void update() {
+    if (current != STATE_NONE) {
+      run(states[current].update);
+    }
+  }
+
+  uint8_t state() const {
+    return current;
+  }
+
+  // Transitions taken since start
+  uint32_t transitionCount() const {
+    return taken;
+  }
+
+private:
+  static void run(StateAction action) {
+    if (action) {
+      action();
+    }
+  }
+
+  bool take(uint8_t event) {
+    const StateTransition &transition = transitions[current][event];
+    if (transition.target == STATE_NONE || (transition.guard && !transition.guard())) {
+      return false;
+    }
+
+    uint8_t from = current;
+    run(states[from].exit);
+    run(transition.action);
+    current = transition.target;
+    run(states[current].enter);
+    taken++;
+
+    if (observer) {
+      observer(from, event, current);
+    }
+    return true;
+  }
+
+  const StateDefinition (&states)[STATES];
+  const TransitionTable &transitions;
+  StateObserver observer;
+  uint8_t current;
+  bool dispatching;
+  uint8_t queued;
+  uint8_t queue[STATE_EVENT_QUEUE];
+  uint32_t taken;
+};
+
+#endif // STATE_MACHINE_H
@@ -0,0 +1,71 @@
+#include "StreamingStats.h"
+
+#include <math.h>
+
+// Two-sided 95% Student's t for 1..30 degrees of freedom; the normal 1.96 after that
+static const float T_95[30] = {
+  12.706f, 4.303f, 3.182f, 2.776f, 2.571f, 2.447f, 2.365f, 2.306f, 2.262f, 2.228f,
+  2.201f, 2.179f, 2.160f, 2.145f, 2.131f, 2.120f, 2.110f, 2.101f, 2.093f, 2.086f,
+  2.080f, 2.074f, 2.069f, 2.064f, 2.060f, 2.056f, 2.052f, 2.048f, 2.045f, 2.042f
+};
+
+RunningStats::RunningStats()
+{
+  reset();
+}
+
+void RunningStats::reset() {
+  n = 0;
+  runningMean = 0;
+  m2 = 0;
+  minValue = 0;
+  maxValue = 0;
+}
+
+void RunningStats::add(float value) {
+  n++;
+  float delta = value - runningMean;
+  runningMean += delta / n;
+  m2 += delta * (value - runningMean);
+
+  if (n == 1 || value < minValue) {
+    minValue = value;
+  }
+  if (n == 1 || value > maxValue) {
+    maxValue = value;
+  }
+}
+
+uint32_t RunningStats::count() const {
+  return n;
+}
+
+float RunningStats::mean() const {
+  return runningMean;
+}
+
+float RunningStats::variance() const {
+  return n > 1 ? m2 / (n - 1) : 0;
+}
+
+float RunningStats::stddev() const {
+  return sqrtf(variance());
+}
+
+float RunningStats::min() const {
+  return minValue;
+}
+
+float RunningStats::max() const {
+  return maxValue;
+}
+
+float RunningStats::confidence95() const {
+  if (n < 2) {
+    return 0;
+  }
+
+  uint32_t dof = n - 1;
+  float t = dof <= 30 ? T_95[dof - 1] : 1.96f;
+  return t * sqrtf(variance() / n);
+}
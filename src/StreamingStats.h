@@ -0,0 +1,99 @@
+#ifndef STREAMING_STATS_H
+#define STREAMING_STATS_H
+
+#include <stdint.h>
+
+// Single-pass count/mean/variance/min/max using Welford's update, so nothing has to be stored
+// and the mean doesn't drift the way a long running float sum does.
+class RunningStats
+{
+public:
+  RunningStats();
+
+  void reset();
+  void add(float value);
+
+  uint32_t count() const;
+  float mean() const;
+  float variance() const;   // Sample variance (n - 1)
+  float stddev() const;
+  float min() const;
+  float max() const;
+
+  // Half-width of the 95% confidence interval on the mean (Student's t for small counts)
+  float confidence95() const;
+
+private:
+  uint32_t n;
+  float runningMean;
+  float m2;
+  float minValue;
+  float maxValue;
+};
+
+// Fixed-bin histogram over [0, RANGE) for approximate percentiles in constant memory.
+// Percentiles are interpolated inside a bin, so the error is at most one bin width (RANGE / BINS).
+// The lowest and highest values are kept too, so values bunched up in one bin interpolate over
+// the span they cover rather than the whole bin.
+template <uint16_t RANGE, uint8_t BINS>
+class PercentileSketch
+{
+  static_assert(BINS > 0 && RANGE % BINS == 0, "RANGE must be a multiple of BINS");
+
+public:
+  PercentileSketch() {
+    reset();
+  }
+
+  void reset() {
+    for (uint8_t i = 0; i < BINS; i++) {
+      bins[i] = 0;
+    }
+    total = 0;
+    lowest = RANGE;
+    highest = 0;
+  }
+
+  void add(uint16_t value) {
+    if (value >= RANGE) {
+      value = RANGE - 1;
+    }
+    bins[value / BIN_WIDTH]++;
+    total++;
+    lowest = value < lowest ? value : lowest;
+    highest = value > highest ? value : highest;
+  }
+
+  uint32_t count() const {
+    return total;
+  }
+
+  // p in [0, 100]. Returns 0 if nothing has been added.
+  float percentile(float p) const {
+    if (total == 0) {
+      return 0;
+    }
+
+    float rank = p * 0.01f * total;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < BINS; i++) {
+      if (bins[i] > 0 && seen + bins[i] >= rank) {
+        float low = i * BIN_WIDTH > lowest ? i * BIN_WIDTH : lowest;
+        float high = (i + 1) * BIN_WIDTH < highest ? (i + 1) * BIN_WIDTH : highest;
+        return low + (rank - seen) / bins[i] * (high - low);
+      }
+      seen += bins[i];
+    }
+    return highest;
+  }
+
+private:
+  static const uint16_t BIN_WIDTH = RANGE / BINS;
+
+  uint16_t bins[BINS];
+  uint32_t total;
+  uint16_t lowest;
+  uint16_t highest;
+};
+
+#endif // STREAMING_STATS_H
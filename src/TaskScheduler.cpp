@@ -0,0 +1,190 @@
+#include "TaskScheduler.h"
+
+#include <string.h>
+
+TaskScheduler::TaskScheduler() : taskCount(0), heapSize(0)
+{
+}
+
+TaskId TaskScheduler::add(TaskCallback callback, uint32_t periodMs, uint32_t deadlineMs) {
+  if (taskCount == SCHEDULER_MAX_TASKS) {
+    return TASK_INVALID;
+  }
+
+  Task &task = tasks[taskCount];
+  task.callback = callback;
+  task.due = 0;
+  task.periodMs = periodMs;
+  task.deadlineMs = deadlineMs;
+  task.heapIndex = TASK_INVALID;
+  memset(&task.stats, 0, sizeof(task.stats));
+
+  return taskCount++;
+}
+
+void TaskScheduler::start(TaskId id, uint32_t delayMs, uint32_t now) {
+  if (id >= taskCount) {
+    return;
+  }
+
+  Task &task = tasks[id];
+  task.due = now + delayMs;
+  if (task.heapIndex == TASK_INVALID) {
+    heapInsert(id);
+  } else {
+    // Already queued: the new due time can move it either way
+    siftUp(task.heapIndex);
+    siftDown(task.heapIndex);
+  }
+}
+
+void TaskScheduler::stop(TaskId id) {
+  if (id < taskCount && tasks[id].heapIndex != TASK_INVALID) {
+    heapRemove(tasks[id].heapIndex);
+  }
+}
+
+void TaskScheduler::setPeriod(TaskId id, uint32_t periodMs) {
+  if (id < taskCount) {
+    tasks[id].periodMs = periodMs;
+  }
+}
+
+bool TaskScheduler::isActive(TaskId id) const {
+  return id < taskCount && tasks[id].heapIndex != TASK_INVALID;
+}
+
+uint8_t TaskScheduler::run(uint32_t now) {
+  uint8_t ran = 0;
+
+  // Bounded so a task that keeps re-arming itself with no delay can't hold up loop() forever
+  while (heapSize > 0 && ran < SCHEDULER_MAX_TASKS && !before(now, tasks[heap[0]].due)) {
+    TaskId id = heap[0];
+    Task &task = tasks[id];
+
+    uint32_t lateness = now - task.due;
+    uint32_t deadline = task.deadlineMs;
+    if (deadline == 0) {
+      deadline = task.periodMs ? task.periodMs : TASK_ONE_SHOT_DEADLINE_MS;
+    }
+    if (lateness > deadline) {
+      task.stats.deadlineMisses++;
+    }
+    if (lateness > task.stats.maxLatenessMs) {
+      task.stats.maxLatenessMs = lateness;
+    }
+
+    // Re-arm before the callback runs, so the callback is free to stop or restart its own task
+    if (task.periodMs) {
+      task.due += task.periodMs;
+      if (!before(now, task.due)) {
+        // Fell a whole period (or more) behind: drop the missed runs instead of bursting them
+        uint32_t behind = now - task.due;
+        task.stats.skippedPeriods += behind / task.periodMs + 1;
+        task.due += (behind / task.periodMs + 1) * task.periodMs;
+      }
+      siftDown(0);
+    } else {
+      heapRemove(0);
+    }
+
+    task.stats.runs++;
+    task.callback();
+    ran++;
+  }
+
+  return ran;
+}
+
+uint32_t TaskScheduler::timeUntilNext(uint32_t now) const {
+  if (heapSize == 0) {
+    return UINT32_MAX;
+  }
+
+  uint32_t due = tasks[heap[0]].due;
+  return before(now, due) ? due - now : 0;
+}
+
+const TaskStats &TaskScheduler::stats(TaskId id) const {
+  return tasks[id < taskCount ? id : 0].stats;
+}
+
+uint32_t TaskScheduler::deadlineMisses() const {
+  uint32_t misses = 0;
+  for (uint8_t i = 0; i < taskCount; i++) {
+    misses += tasks[i].stats.deadlineMisses;
+  }
+  return misses;
+}
+
+void TaskScheduler::resetStats() {
+  for (uint8_t i = 0; i < taskCount; i++) {
+    memset(&tasks[i].stats, 0, sizeof(tasks[i].stats));
+  }
+}
+
+// Wrap-safe "a is earlier than b" for millis() timestamps
+bool TaskScheduler::before(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) < 0;
+}
+
+void TaskScheduler::heapInsert(TaskId id) {
+  heap[heapSize] = id;
+  tasks[id].heapIndex = heapSize;
+  heapSize++;
+  siftUp(heapSize - 1);
+}
+
+void TaskScheduler::heapRemove(uint8_t index) {
+  tasks[heap[index]].heapIndex = TASK_INVALID;
+  heapSize--;
+
+  if (index != heapSize) {
+    // Fill the hole with the last entry, which may belong either above or below it
+    TaskId moved = heap[heapSize];
+    heap[index] = moved;
+    tasks[moved].heapIndex = index;
+    siftUp(index);
+    siftDown(tasks[moved].heapIndex);
+  }
+}
+
+void TaskScheduler::siftUp(uint8_t index) {
+  while (index > 0) {
+    uint8_t parent = (index - 1) / 2;
+    if (!before(tasks[heap[index]].due, tasks[heap[parent]].due)) {
+      break;
+    }
+    swap(index, parent);
+    index = parent;
+  }
+}
+
+void TaskScheduler::siftDown(uint8_t index) {
+  while (true) {
+    uint8_t smallest = index;
+    uint8_t left = 2 * index + 1;
+    uint8_t right = left + 1;
+
+    if (left < heapSize && before(tasks[heap[left]].due, tasks[heap[smallest]].due)) {
+      smallest = left;
+    }
+    if (right < heapSize && before(tasks[heap[right]].due, tasks[heap[smallest]].due)) {
+      smallest = right;
+    }
+    if (smallest == index) {
+      break;
+    }
+
+    swap(index, smallest);
+    index = smallest;
+  }
+}
+
+void TaskScheduler::swap(uint8_t a, uint8_t b) {
+  TaskId tmp = heap[a];
+  heap[a] = heap[b];
+  heap[b] = tmp;
+  tasks[heap[a]].heapIndex = a;
+  tasks[heap[b]].heapIndex = b;
+}
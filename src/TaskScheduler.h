@@ -0,0 +1,76 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <stdint.h>
+
+#define SCHEDULER_MAX_TASKS 12
+#define TASK_INVALID 0xFF
+#define TASK_ONE_SHOT_DEADLINE_MS 10 // How late a one-shot task may run before it counts as a miss
+
+typedef uint8_t TaskId;
+typedef void (*TaskCallback)();
+
+struct TaskStats
+{
+  uint32_t runs;
+  uint32_t deadlineMisses;  // Runs that started later than the task's deadline allows
+  uint32_t skippedPeriods;  // Periodic runs dropped because the task fell more than a period behind
+  uint32_t maxLatenessMs;
+};
+
+// Cooperative scheduler for periodic and one-shot tasks, kept in a min-heap ordered by due time.
+// Tasks are registered once (like a Particle Timer) and then started/stopped as needed.
+// Time is always passed in by the caller, so the same code runs off millis() on the device
+// or off a virtual clock.
+class TaskScheduler
+{
+public:
+  TaskScheduler();
+
+  // period == 0 makes a one-shot task. deadlineMs is how late a run may start before it counts
+  // as a miss; 0 means one period for periodic tasks and TASK_ONE_SHOT_DEADLINE_MS for one-shots.
+  // Returns TASK_INVALID if the task table is full.
+  TaskId add(TaskCallback callback, uint32_t periodMs, uint32_t deadlineMs = 0);
+
+  // (Re)arm a task to first run delayMs from now
+  void start(TaskId id, uint32_t delayMs, uint32_t now);
+  void stop(TaskId id);
+  void setPeriod(TaskId id, uint32_t periodMs);
+  bool isActive(TaskId id) const;
+
+  // Run every task that is due at 'now'. Returns how many ran.
+  uint8_t run(uint32_t now);
+
+  // Milliseconds until the next task is due, or UINT32_MAX if nothing is scheduled
+  uint32_t timeUntilNext(uint32_t now) const;
+
+  const TaskStats &stats(TaskId id) const;
+  uint32_t deadlineMisses() const;  // Summed over every task
+  void resetStats();
+
+private:
+  struct Task
+  {
+    TaskCallback callback;
+    uint32_t due;
+    uint32_t periodMs;
+    uint32_t deadlineMs;
+    uint8_t heapIndex;      // Position in heap, or TASK_INVALID when not scheduled
+    TaskStats stats;
+  };
+
+  static bool before(uint32_t a, uint32_t b);
+
+  void heapInsert(TaskId id);
+  void heapRemove(uint8_t index);
+  void siftUp(uint8_t index);
+  void siftDown(uint8_t index);
+  void swap(uint8_t a, uint8_t b);
+
+  Task tasks[SCHEDULER_MAX_TASKS];
+  uint8_t taskCount;
+  TaskId heap[SCHEDULER_MAX_TASKS];
+  uint8_t heapSize;
+};
+
+#endif // TASK_SCHEDULER_H
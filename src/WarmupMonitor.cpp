@@ -0,0 +1,85 @@
+#include "WarmupMonitor.h"
+
+#include <math.h>
+
+WarmupMonitor::WarmupMonitor()
+{
+  reset();
+}
+
+void WarmupMonitor::reset() {
+  filter.reset();
+  next = 0;
+  filled = 0;
+  stableRuns = 0;
+  isStable = false;
+  lastLevel = 0;
+  lastSpread = 0;
+  lastSlope = 0;
+}
+
+void WarmupMonitor::addSamples(const uint16_t *samples, uint16_t count) {
+  for (uint16_t i = 0; i < count; i++) {
+    int32_t filtered;
+    if (filter.process(samples[i], filtered)) {
+      update(filtered);
+    }
+  }
+}
+
+void WarmupMonitor::update(int32_t value) {
+  recent[next] = value;
+  next = next + 1 == WARMUP_WINDOWS ? 0 : next + 1;
+  if (filled < WARMUP_WINDOWS) {
+    filled++;
+    if (filled < WARMUP_WINDOWS) {
+      return;
+    }
+  }
+
+  // Once full, 'next' points at the oldest window. Least-squares line against window index.
+  RunningStats stats;
+  float centre = (WARMUP_WINDOWS - 1) * 0.5f;
+  float covariance = 0;
+  float indexVariance = 0;
+  for (uint8_t i = 0; i < WARMUP_WINDOWS; i++) {
+    int32_t v = recent[(next + i) % WARMUP_WINDOWS];
+    stats.add(v);
+    covariance += (i - centre) * v;
+    indexVariance += (i - centre) * (i - centre);
+  }
+  lastLevel = stats.mean();
+  lastSlope = covariance / indexVariance;
+
+  // Scatter about the line is the noise floor, and gives the standard error of the slope
+  float residuals = 0;
+  for (uint8_t i = 0; i < WARMUP_WINDOWS; i++) {
+    float r = recent[(next + i) % WARMUP_WINDOWS] - (lastLevel + lastSlope * (i - centre));
+    residuals += r * r;
+  }
+  lastSpread = sqrtf(residuals / (WARMUP_WINDOWS - 2));
+
+  float slopeLimit = WARMUP_SLOPE_ERRORS * lastSpread / sqrtf(indexVariance);
+  if (slopeLimit < WARMUP_STABLE_SLOPE * lastLevel) {
+    slopeLimit = WARMUP_STABLE_SLOPE * lastLevel;
+  }
+  bool settled = lastSpread <= WARMUP_STABLE_SCATTER * lastLevel && fabsf(lastSlope) <= slopeLimit;
+  stableRuns = settled ? (stableRuns < WARMUP_STABLE_RUNS ? stableRuns + 1 : stableRuns) : 0;
+  isStable = stableRuns >= WARMUP_STABLE_RUNS;
+}
+
+bool WarmupMonitor::stable() const {
+  return isStable;
+}
+
+float WarmupMonitor::level() const {
+  return lastLevel;
+}
+
+float WarmupMonitor::spread() const {
+  return lastSpread;
+}
+
+float WarmupMonitor::slope() const {
+  return lastSlope;
+}
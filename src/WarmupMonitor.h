@@ -0,0 +1,50 @@
+#ifndef WARMUP_MONITOR_H
+#define WARMUP_MONITOR_H
+
+#include <stdint.h>
+#include "BreathSession.h"
+
+#define WARMUP_WINDOWS 10             // Rolling span the criterion looks at (2s at 200ms windows)
+#define WARMUP_STABLE_SCATTER 0.02f   // Max scatter about the trend, as a fraction of the level
+#define WARMUP_STABLE_SLOPE 0.001f    // Drift per window that always counts as flat, fraction of the level
+#define WARMUP_SLOPE_ERRORS 2.0f      // Steeper is still flat within this many standard errors of the slope
+#define WARMUP_STABLE_RUNS 5          // Evaluations in a row that have to pass, so one lucky span doesn't
+
+// Decides when the MQ3 heater has settled: a straight line is fitted to the last WARMUP_WINDOWS
+// filtered windows, and the sensor is stable once the scatter about it is small next to the
+// level and its slope can't be told apart from that scatter (or is tiny next to the level),
+// for WARMUP_STABLE_RUNS windows in a row.
+// Both limits follow the signal, so a noisier sensor or one resting at a different level
+// settles on the same terms. A cold sensor drifts for a long time, a warm restart passes as
+// soon as the span has filled.
+class WarmupMonitor
+{
+public:
+  WarmupMonitor();
+
+  void reset();
+  void addSamples(const uint16_t *samples, uint16_t count);
+
+  bool stable() const;
+
+  // Mean of the span, scatter about the fitted line and its slope (counts per window) at the
+  // last evaluation
+  float level() const;
+  float spread() const;
+  float slope() const;
+
+private:
+  void update(int32_t value);
+
+  MQ3Filter filter;
+  int32_t recent[WARMUP_WINDOWS];
+  uint8_t next;
+  uint8_t filled;
+  uint8_t stableRuns;
+  bool isStable;
+  float lastLevel;
+  float lastSpread;
+  float lastSlope;
+};
+
+#endif // WARMUP_MONITOR_H
@@ -0,0 +1,147 @@
+// Writes synthetic sensor traces in the SensorTrace format (src/SensorTrace.h), for running
+// through tools/trace-replay.cpp when there is no device capture to hand: readings of the full
+// READING_MODE_TIME like the firmware took before breath detection, each with a breath of a given
+// size rising like an MQ3 does, on top of uniform sample noise.
+//
+//   g++ -std=gnu++14 -O2 -Isrc -o breath-trace-gen tools/breath-trace-gen.cpp src/SensorTrace.cpp src/BreathSession.cpp src/BreathDetector.cpp src/ExponentialFit.cpp src/StreamingStats.cpp src/FixedPoint.cpp src/WarmupMonitor.cpp
+//   ./breath-trace-gen out.bin <noise> <rise> [readings] [seed] [warm-up tau]
+//   ./trace-replay out.bin
+//
+// noise is the +/- range of each raw sample in ADC counts and rise how far above clean air the
+// breath heads for, 0 for readings with nobody blowing. Breaths start 0.3-1.5 s into the reading,
+// rise with a time constant of 1-2 s, and last 4-6 s. The peak each breath reaches is printed,
+// to compare with the max PPM trace-replay reports.
+//
+// With a warm-up tau (seconds), the trace starts with WARMING_UP_MAX_TIME of a cold sensor
+// reading high and falling back to clean air with that time constant, as if warm-up still ran
+// to the cap, so trace-replay can show where WarmupMonitor would have ended it.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "SensorTrace.h"
+
+#define SAMPLE_PERIOD_MS 20       // MS_BETWEEN_SAMPLES in the firmware
+#define BATCH_SIZE 16             // SAMPLE_BATCH_SIZE in the firmware
+#define READING_MS 10000          // READING_MODE_TIME in the firmware
+#define IDLE_MS 3000
+#define COOLDOWN_MS 10000
+#define BASELINE_RAW 400
+#define BASELINE_DRIFT 10         // Clean air wanders this far over a reading
+#define WARMUP_MS 60000           // WARMING_UP_MAX_TIME in the firmware
+#define WARMUP_RISE 500           // How far above clean air a cold sensor starts
+
+static FILE *out = NULL;
+static uint32_t seed = 1;
+static uint32_t now = 0;
+
+static void writeFrame(const uint8_t *data, uint16_t length) {
+  fwrite(data, 1, length, out);
+}
+
+static double uniform(double low, double high) {
+  seed = seed * 1103515245 + 12345;
+  return low + (high - low) * ((seed >> 8) & 0xFFFF) / 65535.0;
+}
+
+struct Breath
+{
+  double startMs;
+  double lengthMs;
+  double tauMs;
+  double rise;
+};
+
+static double level(const Breath &breath, double drift, double ms) {
+  double value = BASELINE_RAW + drift * ms / READING_MS;
+  if (breath.rise <= 0 || ms < breath.startMs) {
+    return value;
+  }
+
+  double t = ms - breath.startMs;
+  if (t <= breath.lengthMs) {
+    return value + breath.rise * (1 - exp(-t / breath.tauMs));
+  }
+  double peak = breath.rise * (1 - exp(-breath.lengthMs / breath.tauMs));
+  return value + peak * exp(-(t - breath.lengthMs) / breath.tauMs);
+}
+
+// 'ms' of samples, starting 'offsetMs' into the reading, in firmware-sized batches
+// 'warmupTauMs' non-zero adds a cold heater settling from WARMUP_RISE above clean air
+static void samples(TraceRecorder &trace, const Breath &breath, double drift, uint32_t ms, double noise,
+                    uint32_t offsetMs, double warmupTauMs = 0) {
+  uint16_t batch[BATCH_SIZE];
+  uint16_t count = 0;
+  for (uint32_t t = 0; t < ms; t += SAMPLE_PERIOD_MS) {
+    double value = level(breath, drift, (double)(t + offsetMs)) + uniform(-noise, noise);
+    if (warmupTauMs > 0) {
+      value += WARMUP_RISE * exp(-(double)t / warmupTauMs);
+    }
+    batch[count++] = value < 0 ? 0 : value > 4095 ? 4095 : (uint16_t)value;
+    if (count == BATCH_SIZE) {
+      trace.samples(now + t, batch, count);
+      count = 0;
+    }
+  }
+  if (count > 0) {
+    trace.samples(now + ms, batch, count);
+  }
+  now += ms;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 4) {
+    fprintf(stderr, "usage: %s out.bin noise rise [readings] [seed] [warm-up tau]\n", argv[0]);
+    return 2;
+  }
+  double noise = atof(argv[2]);
+  double rise = atof(argv[3]);
+  int readings = argc > 4 ? atoi(argv[4]) : 20;
+  seed = argc > 5 ? strtoul(argv[5], NULL, 0) : 1;
+  double warmupTauMs = argc > 6 ? atof(argv[6]) * 1000 : 0;
+
+  out = fopen(argv[1], "wb");
+  if (out == NULL) {
+    perror(argv[1]);
+    return 2;
+  }
+
+  TraceRecorder trace(writeFrame);
+  trace.setEnabled(true);
+  trace.header(SAMPLE_PERIOD_MS, MQ3FixedConverter::ppm(BASELINE_RAW));
+
+  Breath none = {0, 0, 1, 0};
+  if (warmupTauMs > 0) {
+    trace.mode(now, TRACE_MODE_WARMING_UP);
+    samples(trace, none, 0, WARMUP_MS, noise, 0, warmupTauMs);
+    printf("warm-up: tau %.1f s, within one count of clean air after %.1f s\n", warmupTauMs / 1000,
+           warmupTauMs * log(WARMUP_RISE) / 1000);
+  }
+  for (int i = 0; i < readings; i++) {
+    Breath breath;
+    breath.startMs = uniform(300, 1500);
+    breath.lengthMs = uniform(4000, 6000);
+    breath.tauMs = uniform(1000, 2000);
+    breath.rise = rise * uniform(0.9, 1.1);
+    double drift = uniform(-BASELINE_DRIFT, BASELINE_DRIFT);
+
+    trace.mode(now, TRACE_MODE_IDLE);
+    samples(trace, none, 0, IDLE_MS, noise, 0);
+    trace.mode(now, TRACE_MODE_READING);
+    samples(trace, breath, drift, READING_MS, noise, 0);
+    trace.mode(now, TRACE_MODE_COOLDOWN);
+    samples(trace, breath, drift, COOLDOWN_MS, noise, READING_MS);
+
+    if (breath.rise > 0) {
+      double peak = breath.rise * (1 - exp(-breath.lengthMs / breath.tauMs));
+      printf("reading %d: breath at %.1f s, tau %.1f s, peak %+.0f counts (%.0f PPM)\n", i + 1,
+             breath.startMs / 1000, breath.tauMs / 1000, peak, calculatePPM(BASELINE_RAW + peak));
+    } else {
+      printf("reading %d: no breath\n", i + 1);
+    }
+  }
+
+  fclose(out);
+  return 0;
+}
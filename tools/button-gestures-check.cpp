@@ -0,0 +1,179 @@
+// Plays synthetic button edge sequences, contact bounce included, through the firmware's
+// ButtonGestures and checks the gestures that come out.
+//
+//   g++ -std=gnu++14 -O2 -Isrc -o button-gestures-check tools/button-gestures-check.cpp src/ButtonGestures.cpp
+//   ./button-gestures-check
+//
+// Each sequence is run three times: with update() every 20 ms like the firmware's button task;
+// the same, but with the clock read a few ms before the edges are drained like pollButton()
+// does, so update() can be behind the edges it has just seen; and with the edges only picked
+// up in one go, long after the fact, as after a slow loop() pass. All have to give the same
+// gestures.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ButtonGestures.h"
+
+// Same as the firmware
+#define DEBOUNCE_MS 20
+#define DOUBLE_CLICK_MS 300
+#define HOLD_MS 500
+#define CLOCK_LAG_MS 5            // How far update() trails the newest edge in the lagging run
+
+struct Edge
+{
+  uint32_t time;
+  bool pressed;
+};
+
+struct Sequence
+{
+  const char *name;
+  std::vector<Edge> edges;
+  const char *expected;
+};
+
+static const char *ACTION_NAMES[] = { "UNPRESSED", "PRESSED", "HOLD", "DOUBLE_CLICK" };
+
+// A clean press from 'down' to 'up', with 'bounces' extra edge pairs a millisecond apart at each end
+static void press(std::vector<Edge> &edges, uint32_t down, uint32_t up, int bounces = 0) {
+  edges.push_back({ down, true });
+  for (int i = 0; i < bounces; i++) {
+    edges.push_back({ down + 1 + 2 * i, false });
+    edges.push_back({ down + 2 + 2 * i, true });
+  }
+  edges.push_back({ up, false });
+  for (int i = 0; i < bounces; i++) {
+    edges.push_back({ up + 1 + 2 * i, true });
+    edges.push_back({ up + 2 + 2 * i, false });
+  }
+}
+
+static std::string collect(ButtonGestures &gestures, std::string &out) {
+  BUTTON_ACTION action;
+  while (gestures.next(action)) {
+    out += out.empty() ? "" : " ";
+    out += ACTION_NAMES[action];
+  }
+  return out;
+}
+
+// 'lagMs' drains edges up to that far past the time update() is then given
+static std::string run(const std::vector<Edge> &edges, uint32_t end, bool polled, uint32_t lagMs = 0) {
+  ButtonGestures gestures(DEBOUNCE_MS, DOUBLE_CLICK_MS, HOLD_MS);
+  std::string out;
+  size_t next = 0;
+
+  if (polled) {
+    for (uint32_t now = 0; now <= end; now += 20) {
+      while (next < edges.size() && edges[next].time <= now + lagMs) {
+        gestures.edge(edges[next].time, edges[next].pressed);
+        next++;
+      }
+      gestures.update(now);
+      collect(gestures, out);
+    }
+  } else {
+    for (; next < edges.size(); next++) {
+      gestures.edge(edges[next].time, edges[next].pressed);
+    }
+    gestures.update(end);
+    collect(gestures, out);
+  }
+  return out;
+}
+
+int main() {
+  std::vector<Sequence> sequences;
+  Sequence s;
+
+  s = { "single click", {}, "PRESSED" };
+  press(s.edges, 1000, 1120);
+  sequences.push_back(s);
+
+  s = { "single click, bouncy contacts", {}, "PRESSED" };
+  press(s.edges, 1000, 1120, 4);
+  sequences.push_back(s);
+
+  s = { "double click", {}, "DOUBLE_CLICK" };
+  press(s.edges, 1000, 1100);
+  press(s.edges, 1250, 1350);
+  sequences.push_back(s);
+
+  s = { "double click, bouncy contacts", {}, "DOUBLE_CLICK" };
+  press(s.edges, 1000, 1100, 3);
+  press(s.edges, 1250, 1350, 3);
+  sequences.push_back(s);
+
+  s = { "two clicks too far apart", {}, "PRESSED PRESSED" };
+  press(s.edges, 1000, 1100);
+  press(s.edges, 1500, 1600);
+  sequences.push_back(s);
+
+  s = { "hold", {}, "HOLD" };
+  press(s.edges, 1000, 2500, 2);
+  sequences.push_back(s);
+
+  s = { "click then hold", {}, "DOUBLE_CLICK" };
+  press(s.edges, 1000, 1100);
+  press(s.edges, 1200, 2500);
+  sequences.push_back(s);
+
+  s = { "hold then click", {}, "HOLD PRESSED" };
+  press(s.edges, 1000, 2000);
+  press(s.edges, 2100, 2200);
+  sequences.push_back(s);
+
+  s = { "triple click", {}, "DOUBLE_CLICK PRESSED" };
+  press(s.edges, 1000, 1100);
+  press(s.edges, 1200, 1300);
+  press(s.edges, 1400, 1500);
+  sequences.push_back(s);
+
+  s = { "glitch shorter than debounce", {}, "" };
+  press(s.edges, 1000, 1010);
+  sequences.push_back(s);
+
+  // Lands just after a 20 ms poll, so the lagging run drains it ahead of update()'s clock
+  s = { "glitch ahead of update()'s clock", {}, "" };
+  press(s.edges, 1001, 1006);
+  sequences.push_back(s);
+
+  s = { "repeated edge at the same level", {}, "PRESSED" };
+  s.edges = { { 1000, true }, { 1005, true }, { 1100, false }, { 1150, false } };
+  sequences.push_back(s);
+
+  s = { "millis() wraps during a double click", {}, "DOUBLE_CLICK" };
+  press(s.edges, 0xFFFFFF00u, 0xFFFFFF60u, 2);
+  press(s.edges, 0xFFFFFFD0u, 0x00000030u, 2);
+  sequences.push_back(s);
+
+  int failures = 0;
+  for (size_t i = 0; i < sequences.size(); i++) {
+    const Sequence &sequence = sequences[i];
+    uint32_t end = sequence.edges.back().time + 2000;
+    uint32_t start = sequence.edges.front().time & ~0xFFFu;
+
+    // Shift so the polled run can count up from 0 even for the wraparound case
+    std::vector<Edge> shifted = sequence.edges;
+    for (size_t e = 0; e < shifted.size(); e++) {
+      shifted[e].time -= start;
+    }
+
+    std::string polled = run(shifted, end - start, true);
+    std::string lagging = run(shifted, end - start, true, CLOCK_LAG_MS);
+    std::string late = run(sequence.edges, end, false);
+    bool ok = polled == sequence.expected && lagging == sequence.expected && late == sequence.expected;
+    printf("%-4s %-38s %s\n", ok ? "ok" : "FAIL", sequence.name, polled.c_str());
+    if (!ok) {
+      printf("     expected \"%s\", polled \"%s\", lagging \"%s\", late \"%s\"\n", sequence.expected, polled.c_str(),
+             lagging.c_str(), late.c_str());
+      failures++;
+    }
+  }
+
+  printf("failures: %d\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,133 @@
+// Host benchmark and accuracy check for the fixed-point MQ3 conversions in src/MQ3Conversion.h:
+// cycles (where the CPU has a cycle counter) and nanoseconds per sample for ppm(), bac() and
+// bacLinear(), next to the double-precision pow() they replace, and the worst error of each
+// against that reference over every ADC code.
+//
+//   g++ -std=gnu++14 -O2 -Isrc -o conversion-bench tools/conversion-bench.cpp src/FixedPoint.cpp
+//   ./conversion-bench
+//
+// bac() is the log2/exp2 evaluation of the power law. The firmware looks BAC up from the
+// table in MQ3LookupTable.h instead (see tools/lookup-table-check.cpp for that side), but a
+// sensor profile that can't afford the 16 KB table would use this. Host numbers only say how
+// the paths compare; the Photon has no FPU, so pow() costs it far more than it does here.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLE_COUNTER 1
+#endif
+
+#include "MQ3Conversion.h"
+
+#define BENCH_SAMPLES 1000000
+#define BENCH_ROUNDS 5
+#define BASELINE_PPM 400.0
+#define MIN_RELATIVE_BAC 0.0001 // Below this a fraction of an LSB is already a large relative error
+
+typedef MQ3FixedConverter Converter;
+
+static double referencePPM(uint16_t raw) {
+  return raw * 5.0 / MQ3_ADC_MAX * 1000.0 / 1.1;
+}
+
+static double referenceBAC(uint16_t raw) {
+  double x = (0.4 * MQ3_R2 * (MQ3_ADC_MAX - raw)) / ((double)MQ3_R0 * raw);
+  return pow(x, MQ3_BAC_EXPONENT) * 0.0001;
+}
+
+static std::vector<uint16_t> makeCodes() {
+  // Every code in 1..4094 equally often, in an order the branch predictor can't learn
+  std::vector<uint16_t> codes(BENCH_SAMPLES);
+  uint32_t seed = 12345;
+  for (size_t i = 0; i < codes.size(); i++) {
+    seed = seed * 1103515245 + 12345;
+    codes[i] = 1 + (seed >> 8) % (MQ3_ADC_MAX - 1);
+  }
+  return codes;
+}
+
+template <typename CONVERT>
+static void bench(const char *name, const std::vector<uint16_t> &codes, CONVERT convert) {
+  double bestNs = 1e30;
+  double bestCycles = 1e30;
+  volatile double sink = 0;
+
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    double sum = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#ifdef HAVE_CYCLE_COUNTER
+    uint64_t startCycles = __rdtsc();
+#endif
+    for (size_t i = 0; i < codes.size(); i++) {
+      sum += convert(codes[i]);
+    }
+#ifdef HAVE_CYCLE_COUNTER
+    double cycles = (double)(__rdtsc() - startCycles) / codes.size();
+    if (cycles < bestCycles) {
+      bestCycles = cycles;
+    }
+#endif
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / codes.size();
+    if (ns < bestNs) {
+      bestNs = ns;
+    }
+    sink = sum;
+  }
+  (void)sink;
+
+#ifdef HAVE_CYCLE_COUNTER
+  printf("%-32s %7.2f cycles/sample %7.2f ns/sample\n", name, bestCycles, bestNs);
+#else
+  printf("%-32s %7.2f ns/sample\n", name, bestNs);
+#endif
+}
+
+int main() {
+  std::vector<uint16_t> codes = makeCodes();
+  int32_t baselineQ = Converter::PpmQ::fromDouble(BASELINE_PPM);
+
+  printf("speed\n");
+  bench("ppm() double reference", codes, [](uint16_t raw) { return referencePPM(raw); });
+  bench("ppm() Q16", codes, [](uint16_t raw) { return (double)Converter::ppm(raw); });
+  bench("bac() double pow()", codes, [](uint16_t raw) { return referenceBAC(raw); });
+  bench("bac() Q24 log2/exp2", codes, [](uint16_t raw) { return (double)Converter::bac(raw); });
+  bench("bacLinear() Q24", codes, [baselineQ](uint16_t raw) { return (double)Converter::bacLinear(raw, baselineQ); });
+
+  // Worst error over every code the curve can represent; near full scale BAC saturates
+  double ppmError = 0;
+  double bacLsbError = 0;
+  double bacRelativeError = 0;
+  double linearLsbError = 0;
+  uint16_t worstBacCode = 0;
+  for (uint16_t raw = 1; raw < MQ3_ADC_MAX; raw++) {
+    ppmError = fmax(ppmError, fabs((double)Converter::ppm(raw) / Converter::PpmQ::ONE - referencePPM(raw)));
+
+    double linear = (referencePPM(raw) - BASELINE_PPM) / MQ3_LINEAR_PPM_PER_BAC * Converter::BacQ::ONE;
+    linearLsbError = fmax(linearLsbError, fabs(Converter::bacLinear(raw, baselineQ) - linear));
+
+    double reference = referenceBAC(raw) * Converter::BacQ::ONE;
+    if (reference >= INT32_MAX) {
+      continue;
+    }
+    double error = fabs(Converter::bac(raw) - reference);
+    if (error > bacLsbError) {
+      bacLsbError = error;
+      worstBacCode = raw;
+    }
+    if (reference >= Converter::BacQ::ONE * MIN_RELATIVE_BAC) {
+      bacRelativeError = fmax(bacRelativeError, error / reference);
+    }
+  }
+
+  printf("\naccuracy against double precision, codes 1..%d\n", MQ3_ADC_MAX - 1);
+  printf("%-32s %.6f ppm\n", "ppm() max error", ppmError);
+  printf("%-32s %.2f LSB (code %u), %.2e relative above %g BAC\n", "bac() max error", bacLsbError,
+         worstBacCode, bacRelativeError, MIN_RELATIVE_BAC);
+  printf("%-32s %.2f LSB\n", "bacLinear() max error", linearLsbError);
+  return 0;
+}
@@ -0,0 +1,89 @@
+// Host benchmark for the MQ3 filter stages in src/SampleFilters.h: cycles (where the CPU has a
+// cycle counter) and nanoseconds per sample for each stage on its own and for a full chain.
+//
+//   g++ -std=gnu++14 -O2 -Isrc -o filter-bench tools/filter-bench.cpp
+//   ./filter-bench
+//
+// Host numbers only say how the stages compare to each other; the Photon has no data cache,
+// no FPU and a slower multiplier, so absolute cost on the device is higher.
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLE_COUNTER 1
+#endif
+
+#include "SampleFilters.h"
+#include "BreathSession.h"
+
+#define BENCH_SAMPLES 1000000
+#define BENCH_ROUNDS 5
+
+static std::vector<int32_t> makeSamples() {
+  // Slow breath-shaped ramp plus noise and the odd spike, in 12-bit ADC counts
+  std::vector<int32_t> samples(BENCH_SAMPLES);
+  uint32_t seed = 12345;
+  for (size_t i = 0; i < samples.size(); i++) {
+    seed = seed * 1103515245 + 12345;
+    int32_t noise = (int32_t)((seed >> 16) & 63) - 32;
+    int32_t spike = (seed & 0xFFF) == 0 ? 800 : 0;
+    int32_t level = 600 + (int32_t)((i % 5000) < 2500 ? (i % 5000) : 5000 - (i % 5000)) / 2;
+    samples[i] = level + noise + spike;
+  }
+  return samples;
+}
+
+template <typename FILTER>
+static void bench(const char *name, const std::vector<int32_t> &samples) {
+  double bestNs = 1e30;
+  double bestCycles = 1e30;
+  volatile int32_t sink = 0;
+
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    FILTER filter;
+    int32_t out = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#ifdef HAVE_CYCLE_COUNTER
+    uint64_t startCycles = __rdtsc();
+#endif
+    for (size_t i = 0; i < samples.size(); i++) {
+      if (filter.process(samples[i], out)) {
+        sink = out;
+      }
+    }
+#ifdef HAVE_CYCLE_COUNTER
+    double cycles = (double)(__rdtsc() - startCycles) / samples.size();
+    if (cycles < bestCycles) {
+      bestCycles = cycles;
+    }
+#endif
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / samples.size();
+    if (ns < bestNs) {
+      bestNs = ns;
+    }
+  }
+  (void)sink;
+
+#ifdef HAVE_CYCLE_COUNTER
+  printf("%-40s %7.2f cycles/sample %7.2f ns/sample\n", name, bestCycles, bestNs);
+#else
+  printf("%-40s %7.2f ns/sample\n", name, bestNs);
+#endif
+}
+
+int main() {
+  std::vector<int32_t> samples = makeSamples();
+
+  bench<Median3>("Median3", samples);
+  bench<IIRLowPass<8192> >("IIRLowPass<8192>", samples);
+  bench<FIR<4096, 8192, 8192, 8192, 4096> >("FIR<5 taps>", samples);
+  bench<Decimate<SAMPLES_PER_WINDOW> >("Decimate<10>", samples);
+  bench<Pipeline<Median3, IIRLowPass<8192>, Decimate<SAMPLES_PER_WINDOW> > >("Median3 > IIRLowPass > Decimate<10>", samples);
+  bench<MQ3Filter>("MQ3Filter (configured chain)", samples);
+
+  return 0;
+}
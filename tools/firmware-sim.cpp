@@ -0,0 +1,233 @@
+// Runs the real firmware (src/IoT-Breathalyzer.ino and everything it links) on Linux, against the
+// host stand-ins for Device OS in tools/sim/ and a virtual clock, through one scripted session:
+// power-up and warm-up, a button press and a breath, the result, the cloud publish, and reading
+// the result back from the session log over Serial and the "history" cloud function.
+//
+//   g++ -std=gnu++14 -O2 -DPARTICLE -Itools/sim -Isrc -Ilib/Grove_LCD_RGB_Backlight/src -Ilib/neopixel/src -o firmware-sim tools/firmware-sim.cpp tools/sim/SimHost.cpp src/[A-HJ-Z]*.cpp lib/Grove_LCD_RGB_Backlight/src/*.cpp lib/neopixel/src/neopixel.cpp
+//   ./firmware-sim [-v]
+//
+// The sketch itself is #included below, so the stale src/IoT-Breathalyzer.cpp is left out.
+//
+// Besides checking the session's outcome, it checks loop() never sleeps: delay() and
+// delayMicroseconds() count against the firmware once setup() is done, and a pass that keeps
+// reading the clock without returning is stopped as a spin. With -v the LCD and Serial output
+// are printed as they change.
+
+#include "SimHost.h"
+
+#include "IoT-Breathalyzer.ino"
+
+#define SIM_PASS_US 1000            // loop() runs at most once per millisecond
+#define SIM_BASELINE_RAW 400        // Clean-air ADC counts once warm
+#define SIM_WARMUP_RAW 500          // How far above clean air a cold sensor reads
+#define SIM_WARMUP_TAU_MS 6000
+#define SIM_BREATH_RAW 600          // Rise from a breath, in ADC counts
+#define SIM_BREATH_TAU_MS 1500
+#define SIM_BREATH_LENGTH_MS 6000
+#define SIM_NOISE 3                 // +/- counts
+#define SIM_START_TIME 1767225600   // Wall clock once synced, 2026-01-01
+
+static bool verbose = false;
+static int failures = 0;
+static uint64_t breathStartUs = 0;
+static uint64_t breathEndUs = 0;
+static uint64_t longestPassUs = 0;
+static std::string lcdShown[2];
+static std::string serialShown;
+
+static void check(bool ok, const char *what) {
+  printf("  %-58s %s\n", what, ok ? "ok" : "FAILED");
+  if (!ok) {
+    failures++;
+  }
+}
+
+static int32_t noise() {
+  static uint32_t seed = 1;
+  seed = seed * 1103515245 + 12345;
+  return (int32_t)((seed >> 16) % (2 * SIM_NOISE + 1)) - SIM_NOISE;
+}
+
+// The MQ3 on A1: settling from cold after power-up, plus a breath when one is scripted
+static int32_t sensor(pin_t pin, uint64_t nowUs) {
+  double level = SIM_BASELINE_RAW + SIM_WARMUP_RAW * exp(-(nowUs / 1000.0) / SIM_WARMUP_TAU_MS);
+  if (breathStartUs && nowUs >= breathStartUs) {
+    double rise = SIM_BREATH_RAW * (1 - exp(-((nowUs - breathStartUs) / 1000.0) / SIM_BREATH_TAU_MS));
+    if (nowUs > breathEndUs) {
+      double peak = SIM_BREATH_RAW * (1 - exp(-(double)(breathEndUs - breathStartUs) / 1000.0 / SIM_BREATH_TAU_MS));
+      rise = peak * exp(-((nowUs - breathEndUs) / 1000.0) / SIM_BREATH_TAU_MS);
+    }
+    level += rise;
+  }
+  return (int32_t)level + noise();
+}
+
+static void showOutput() {
+  std::string out = simTakeSerialOutput();
+  if (verbose && !out.empty()) {
+    fputs(out.c_str(), stdout);
+  }
+  serialShown += out;
+  for (uint8_t row = 0; row < 2; row++) {
+    std::string line = simLcdLine(row);
+    if (verbose && line != lcdShown[row]) {
+      printf("%8.3f s  LCD %u |%s|\n", simMicros() / 1e6, row, line.c_str());
+    }
+    lcdShown[row] = line;
+  }
+}
+
+static void pass() {
+  uint64_t start = simMicros();
+  simBeginPass();
+  loop();
+  uint64_t took = simMicros() - start;
+  if (took > longestPassUs) {
+    longestPassUs = took;
+  }
+  if (took < SIM_PASS_US) {
+    simAdvance(SIM_PASS_US - took);
+  }
+  showOutput();
+}
+
+static void runFor(uint32_t ms) {
+  uint64_t end = simMicros() + (uint64_t)ms * 1000;
+  while (simMicros() < end) {
+    pass();
+  }
+}
+
+// Run until the device is in 'mode', or give up after timeoutMs. Returns the time it took.
+static uint32_t runUntilMode(uint8_t mode, uint32_t timeoutMs) {
+  uint64_t start = simMicros();
+  while (modes.state() != mode && simMicros() - start < (uint64_t)timeoutMs * 1000) {
+    pass();
+  }
+  return (uint32_t)((simMicros() - start) / 1000);
+}
+
+static void pressButton(uint32_t ms) {
+  simSetPin(BUTTON_PIN, HIGH);
+  runFor(ms);
+  simSetPin(BUTTON_PIN, LOW);
+}
+
+int main(int argc, char **argv) {
+  verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+  simSetAnalogSource(sensor);
+
+  printf("power-up\n");
+  setup();
+  showOutput();
+  simResetStats();    // From here on, any delay is loop() sleeping
+
+  uint32_t warmupMs = runUntilMode(IDLE, WARMING_UP_MAX_TIME + 1000);
+  printf("  warm-up took %u ms, baseline %d PPM\n", (unsigned)warmupMs, (int)(baseLinePPM >> 16));
+  check(modes.state() == IDLE, "warm-up ends");
+  check(warmupMs < WARMING_UP_MAX_TIME, "warm-up ends on a settled reading, before the cap");
+  check(lcdShown[0].compare(0, 8, "READY...") == 0, "LCD says READY");
+
+  simSetTime(SIM_START_TIME);
+  runFor(5000);
+
+  printf("breath\n");
+  pressButton(120);
+  runUntilMode(READING, DOUBLE_CLICK_WAIT_TIME + 100);   // A single click is only sure once no second one follows
+  check(modes.state() == READING, "a press starts a reading");
+  breathStartUs = simMicros() + 300000;
+  breathEndUs = breathStartUs + (uint64_t)SIM_BREATH_LENGTH_MS * 1000;
+  uint32_t readingMs = runUntilMode(COOLDOWN, READING_MODE_TIME + 1000);
+  runFor(100);
+  printf("  reading took %u ms, max %d PPM, avg %d PPM\n", (unsigned)readingMs, maxPPM, avgPPM);
+  check(modes.state() == COOLDOWN, "the reading ends");
+  check(maxPPM > 0 && avgPPM > 0 && avgPPM <= maxPPM, "the result is sane");
+  check(lcdShown[0].compare(0, 8, "MAX PPM:") == 0 && lcdShown[1].compare(0, 8, "AVG PPM:") == 0,
+        "LCD shows the result");
+
+  runUntilMode(IDLE, COOLDOWN_TIME + 1000);
+  check(modes.state() == IDLE, "cool-down ends");
+  runFor(PUBLISH_FLUSH_PERIOD + 1000);
+
+  printf("cloud\n");
+  bool published = false;
+  bool noAck = true;
+  for (const SimPublish &event : simPublishes()) {
+    noAck &= event.noAck;
+    PublishRecord records[PUBLISH_QUEUE_SLOTS];
+    uint8_t count = PublishQueue::decode(event.data.c_str(), records, PUBLISH_QUEUE_SLOTS);
+    printf("  %8.3f s  %s %s (%u results)\n", event.timeUs / 1e6, event.name.c_str(), event.data.c_str(), count);
+    if (event.name == "breathResults" && count == 1 && records[0].maxPPM == maxPPM && records[0].avgPPM == avgPPM) {
+      published = true;
+    }
+  }
+  check(published, "the result is published");
+  check(noAck, "without waiting for an ACK");
+  check(publishQueue.pending() == 0, "nothing is left queued");
+  check(simVariable("maxPPM") == std::to_string(maxPPM), "maxPPM cloud variable");
+
+  // A send the cloud drops goes again, but no sooner than the next flush
+  simClearPublishes();
+  simSetPublishResult(false);
+  PublishRecord retried = {};
+  retried.maxPPM = maxPPM;
+  publishQueue.push(retried);
+  runFor(PUBLISH_FLUSH_PERIOD * 3);
+  simSetPublishResult(true);
+  runFor(PUBLISH_FLUSH_PERIOD * 2);
+  const std::vector<SimPublish> &attempts = simPublishes();
+  bool spaced = attempts.size() >= 3;
+  for (size_t i = 1; i < attempts.size(); i++) {
+    spaced &= attempts[i].timeUs - attempts[i - 1].timeUs >= PUBLISH_FLUSH_PERIOD * 1000ull;
+  }
+  printf("  %u tries\n", (unsigned)attempts.size());
+  check(spaced, "a dropped send is retried once per flush, not sooner");
+  check(!attempts.empty() && attempts.back().delivered && publishQueue.pending() == 0,
+        "and leaves the queue once it gets through");
+
+  simClearPublishes();
+  int expected = simCallFunction("history", "0");
+  runFor(HISTORY_PUBLISH_PERIOD * 2);
+  check(expected == 1, "history request finds the result");
+  check(simPublishes().size() == 1 && simPublishes()[0].name == "breathHistory", "history is published");
+  check(simPublishes().size() == 1 && simPublishes()[0].noAck, "also without waiting for an ACK");
+
+  // The first request's event is still in flight when the second comes in
+  simClearPublishes();
+  simCallFunction("history", "0");
+  runFor(10);
+  uint64_t againUs = simMicros();
+  expected = simCallFunction("history", "0");
+  runFor(HISTORY_PUBLISH_PERIOD * 2);
+  check(expected == 1 && simPublishes().size() == 2 && simPublishes()[1].timeUs - againUs < 100000,
+        "a second request starts the stream over at once");
+  check(historyQueue.pending() == 0 && !scheduler.isActive(historyTask), "and leaves nothing behind");
+
+  printf("serial\n");
+  serialShown.clear();
+  simSerialInput("log\n");
+  runFor(200);
+  char row[64];
+  snprintf(row, sizeof(row), ",%d,%d,", maxPPM, avgPPM);
+  check(serialShown.find(row) != std::string::npos, "\"log\" lists the result");
+  serialShown.clear();
+  simSerialInput("stats\n");
+  runFor(200);
+  check(serialShown.find("samples ") != std::string::npos && serialShown.find("dropped: 0 samples") != std::string::npos,
+        "\"stats\" lists the tasks and what was dropped");
+
+  printf("loop\n");
+  printf("  longest pass %.2f ms, I2C %u transactions / %u bytes, %u samples\n", longestPassUs / 1000.0,
+         (unsigned)simStats().i2cTransactions, (unsigned)simStats().i2cBytes, (unsigned)sampler.totalSamples());
+  check(simStats().delayCalls == 0, "loop() never sleeps");
+  check(sampler.droppedSamples() == 0, "no samples dropped");
+  check(button.droppedEdges() == 0, "no button edges dropped");
+  check(scheduler.deadlineMisses() == 0, "no task ran late");
+  runFor(SUMMARY_PERIOD);
+  std::string healthShown = simVariable("health");
+  printf("  health: %s\n", healthShown.c_str());
+  check(healthShown.find("late=0 samples=0 edges=0 lcd=0") == 0, "the health variable says the same");
+
+  printf("%s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
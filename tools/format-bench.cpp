@@ -0,0 +1,198 @@
+// Host benchmark for src/NumberFormat.h against what the firmware used before: Print::print(float)
+// for the LCD fields and String(int) ahead of each publish. Both are copied here from the Wiring
+// core the Photon firmware uses, since neither exists off the device.
+//
+//   g++ -std=gnu++14 -O2 -Isrc -o format-bench tools/format-bench.cpp src/BreathSession.cpp src/BreathDetector.cpp src/ExponentialFit.cpp src/StreamingStats.cpp src/FixedPoint.cpp
+//   ./format-bench
+//
+// Host numbers only say how the approaches compare; the Photon does the double maths in
+// Print::printFloat() in software, so the gap there is wider.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "BreathSession.h"
+#include "NumberFormat.h"
+
+#define BENCH_VALUES 4096
+#define BENCH_ROUNDS 200
+
+static unsigned long allocations = 0;
+
+// Stands in for the LCD framebuffer: just takes characters
+struct FieldSink
+{
+  char cells[32];
+  uint8_t used;
+
+  void write(char c) {
+    cells[used++ & 31] = c;
+  }
+
+  void print(const char *text) {
+    while (*text) {
+      write(*text++);
+    }
+  }
+};
+
+// Print::printNumber() and Print::printFloat() from the Wiring core
+static void printNumber(FieldSink &out, unsigned long n) {
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  do {
+    unsigned long m = n;
+    n /= 10;
+    *--str = m - 10 * n + '0';
+  } while (n);
+  out.print(str);
+}
+
+static void printFloat(FieldSink &out, double number, uint8_t digits) {
+  if (number < 0.0) {
+    out.write('-');
+    number = -number;
+  }
+
+  double rounding = 0.5;
+  for (uint8_t i = 0; i < digits; ++i) {
+    rounding /= 10.0;
+  }
+  number += rounding;
+
+  unsigned long intPart = (unsigned long)number;
+  double remainder = number - (double)intPart;
+  printNumber(out, intPart);
+  if (digits > 0) {
+    out.write('.');
+  }
+  while (digits-- > 0) {
+    remainder *= 10.0;
+    int toPrint = int(remainder);
+    printNumber(out, toPrint);
+    remainder -= toPrint;
+  }
+}
+
+// Just enough of Wiring's String(int) to show its cost: itoa into a stack buffer, then a heap copy
+class HeapString
+{
+public:
+  HeapString(int value) {
+    char buf[2 + 8 * sizeof(int)];
+    snprintf(buf, sizeof(buf), "%d", value);
+    buffer = (char *)malloc(strlen(buf) + 1);
+    strcpy(buffer, buf);
+    allocations++;
+  }
+
+  ~HeapString() {
+    free(buffer);
+  }
+
+  const char *c_str() const {
+    return buffer;
+  }
+
+private:
+  char *buffer;
+};
+
+template <typename BODY>
+static void bench(const char *name, BODY body) {
+  double bestNs = 1e30;
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    body();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BENCH_VALUES;
+    if (ns < bestNs) {
+      bestNs = ns;
+    }
+  }
+  printf("%-34s %7.1f ns per field\n", name, bestNs);
+}
+
+int main() {
+  // Window values across the sensor's range, as the READING screen would see them
+  std::vector<int> raw(BENCH_VALUES);
+  std::vector<int32_t> ppmQ(BENCH_VALUES), bacQ(BENCH_VALUES);
+  std::vector<float> ppm(BENCH_VALUES), bac(BENCH_VALUES);
+  for (int i = 0; i < BENCH_VALUES; i++) {
+    raw[i] = 1 + (i * 2654435761u) % (MQ3_ADC_MAX - 1);
+    ppmQ[i] = calculatePPMQ(raw[i]);
+    bacQ[i] = calculateBACQ(raw[i], 0);
+    ppm[i] = calculatePPM(raw[i]);
+    bac[i] = calculateBAC(raw[i], 0);
+  }
+
+  FieldSink sink;
+  sink.used = 0;
+  char field[NUMBER_FIELD_SIZE];
+
+  bench("Print::print(float) PPM", [&]() {
+    for (int i = 0; i < BENCH_VALUES; i++) {
+      printFloat(sink, ppm[i], 2);
+    }
+  });
+  bench("formatFixed<16> PPM", [&]() {
+    for (int i = 0; i < BENCH_VALUES; i++) {
+      formatFixed<16>(field, 8, ppmQ[i], 2);
+      sink.print(field);
+    }
+  });
+  bench("Print::print(float) BAC", [&]() {
+    for (int i = 0; i < BENCH_VALUES; i++) {
+      printFloat(sink, bac[i], 4);
+    }
+  });
+  bench("formatFixed<24> BAC", [&]() {
+    for (int i = 0; i < BENCH_VALUES; i++) {
+      formatFixed<24>(field, 8, bacQ[i], 4);
+      sink.print(field);
+    }
+  });
+  bench("formatFloat BAC", [&]() {
+    for (int i = 0; i < BENCH_VALUES; i++) {
+      formatFloat(field, 8, bac[i], 4);
+      sink.print(field);
+    }
+  });
+
+  allocations = 0;
+  bench("String(int)", [&]() {
+    for (int i = 0; i < BENCH_VALUES; i++) {
+      HeapString text((int)ppm[i]);
+      sink.print(text.c_str());
+    }
+  });
+  unsigned long stringAllocations = allocations;
+  bench("formatInt", [&]() {
+    for (int i = 0; i < BENCH_VALUES; i++) {
+      formatInt(field, 0, (int)ppm[i]);
+      sink.print(field);
+    }
+  });
+  printf("heap allocations per String(int): %.1f, per format call: 0\n",
+         (double)stringAllocations / (BENCH_VALUES * BENCH_ROUNDS));
+
+  // The fixed-point path has to agree with what Print showed
+  int differences = 0;
+  for (int i = 0; i < BENCH_VALUES; i++) {
+    FieldSink expected;
+    expected.used = 0;
+    printFloat(expected, ppm[i], 2);
+    expected.cells[expected.used] = '\0';
+    formatFixed<16>(field, 0, ppmQ[i], 2);
+    if (strcmp(field, expected.cells) != 0) {
+      differences++;
+    }
+  }
+  printf("PPM fields that differ from Print::print(float): %d of %d\n", differences, BENCH_VALUES);
+  volatile uint8_t keep = sink.used;   // Keeps the formatting from being optimised away
+  (void)keep;
+  return differences ? 1 : 0;
+}
@@ -0,0 +1,128 @@
+// Drives rgb_lcd in asynchronous mode as hard as loop() ever could, on the virtual clock and mock
+// Wire bus from tools/sim/, and checks nothing in it waits: no delay() or delayMicroseconds(),
+// and no pass that spins on micros() (the simulation aborts one). It also checks the text on
+// the display, decoded from the bus, ends up matching what was drawn, and that I2CQueue keeps
+// to every hold-off without sleeping when more devices want one than it has slots for.
+//
+//   g++ -std=gnu++14 -O2 -DPARTICLE -Itools/sim -Isrc -Ilib/Grove_LCD_RGB_Backlight/src -o lcd-async-check tools/lcd-async-check.cpp tools/sim/SimHost.cpp src/LcdFramebuffer.cpp lib/Grove_LCD_RGB_Backlight/src/*.cpp
+//   ./lcd-async-check
+
+#include <cstdio>
+
+#include "SimHost.h"
+#include "LcdFramebuffer.h"
+
+#define PASS_US 1000
+#define PASSES 5000
+#define HOLD_OFF_US 2000
+
+static int failures = 0;
+
+static void check(bool ok, const char *what) {
+  printf("  %-56s %s\n", what, ok ? "ok" : "FAILED");
+  if (!ok) {
+    failures++;
+  }
+}
+
+static uint32_t nextRandom() {
+  static uint32_t seed = 3;
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8;
+}
+
+// One loop() pass worth of display work, then the rest of the millisecond
+static void pass(LcdFramebuffer &display, rgb_lcd &lcd) {
+  uint64_t start = simMicros();
+  simBeginPass();
+  display.flush();
+  lcd.update();
+  uint64_t took = simMicros() - start;
+  simAdvance(took < PASS_US ? PASS_US - took : 0);
+}
+
+// Keep passing until the queue has drained and the framebuffer has nothing left to send
+static void settle(LcdFramebuffer &display, rgb_lcd &lcd) {
+  for (int i = 0; i < 1000 && (lcd.busy() || display.isDirty()); i++) {
+    pass(display, lcd);
+  }
+}
+
+static bool glassShows(const char *row0, const char *row1) {
+  return simLcdLine(0) == row0 && simLcdLine(1) == row1;
+}
+
+int main() {
+  rgb_lcd lcd;
+  LcdFramebuffer display(lcd);
+  lcd.setAsync(true);
+  lcd.begin(LCD_COLS, LCD_ROWS);
+  lcd.setRGB(255, 0, 0);
+
+  printf("power-up, queued\n");
+  settle(display, lcd);
+  check(simStats().delayCalls == 0, "begin() holds the LCD off instead of sleeping");
+
+  printf("every cell changing on every pass\n");
+  char rows[2][LCD_COLS + 1] = {};
+  for (int i = 0; i < PASSES; i++) {
+    for (uint8_t row = 0; row < LCD_ROWS; row++) {
+      for (uint8_t col = 0; col < LCD_COLS; col++) {
+        rows[row][col] = 'A' + nextRandom() % 26;
+      }
+      display.setCursor(0, row);
+      display.print(rows[row]);
+    }
+    if (i % 100 == 0) {
+      lcd.setRGB(i & 0xFF, 0, 0);
+    }
+    pass(display, lcd);
+  }
+  settle(display, lcd);
+  printf("  %u transactions, %u writes dropped\n", (unsigned)simStats().i2cTransactions, (unsigned)lcd.droppedWrites());
+  check(simStats().delayCalls == 0, "no delays");
+  check(lcd.droppedWrites() == 0, "the framebuffer never overruns the queue");
+  check(glassShows(rows[0], rows[1]), "the display shows the last frame");
+
+  printf("printing straight to the LCD without update()\n");
+  for (int i = 0; i < 40; i++) {
+    lcd.setCursor(0, i & 1);
+    lcd.print("0123456789ABCDEF");
+  }
+  uint32_t dropped = lcd.droppedWrites();
+  printf("  %u writes dropped\n", (unsigned)dropped);
+  check(simStats().delayCalls == 0, "a full queue drops the write instead of waiting");
+  check(dropped > 0, "drops are counted");
+  settle(display, lcd);
+  check(glassShows(rows[0], rows[1]), "the framebuffer redraws the screen after a drop");
+
+  printf("more devices holding off than the queue has room for\n");
+  I2CQueue queue;
+  const uint8_t first = 0x10, second = 0x11, third = 0x12;
+  const uint8_t byte = 0;
+  simResetStats();
+  uint64_t start = simMicros();
+  bool kept = queue.holdOff(first, HOLD_OFF_US) && queue.holdOff(second, HOLD_OFF_US);
+  check(kept && !queue.holdOff(third, HOLD_OFF_US), "holdOff() says so when there is nowhere to keep it");
+
+  // a write to the third device that needs a hold-off after it has to wait for a free slot
+  queue.enqueue(third, &byte, 1, I2C_PRIORITY_HIGH);
+  queue.holdOff(third, HOLD_OFF_US);
+  queue.enqueue(third, &byte, 1, I2C_PRIORITY_HIGH);
+  uint64_t sentAt[2] = {};
+  uint8_t sent = 0;
+  while (!queue.empty() && simMicros() < start + 1000000) {
+    simBeginPass();
+    queue.poll(1);
+    if (simStats().i2cBytesTo[third] > sent * 2u) {
+      sentAt[sent++] = simMicros();
+    }
+    simAdvance(100);
+  }
+  check(simStats().delayCalls == 0, "a hold-off with nowhere to go never sleeps");
+  check(sent == 2 && sentAt[0] >= start + HOLD_OFF_US, "the write waits in the queue for a free slot");
+  check(sent == 2 && sentAt[1] - sentAt[0] >= HOLD_OFF_US, "and still gets its full hold-off");
+
+  printf("%s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
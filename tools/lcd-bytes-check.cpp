@@ -0,0 +1,108 @@
+// Counts the I2C bytes it takes to show a reading on the LCD two ways: printing straight to
+// rgb_lcd like the sketch used to, and printing into the LcdFramebuffer shadow copy and flushing
+// it once per pass. Both run against the mock Wire bus from tools/sim/, which also decodes what
+// ends up on the display, so the two can be checked to leave the same text behind.
+//
+//   g++ -std=gnu++14 -O2 -DPARTICLE -Itools/sim -Isrc -Ilib/Grove_LCD_RGB_Backlight/src -o lcd-bytes-check tools/lcd-bytes-check.cpp tools/sim/SimHost.cpp src/LcdFramebuffer.cpp lib/Grove_LCD_RGB_Backlight/src/*.cpp
+//   ./lcd-bytes-check
+//
+// The screen script is one reading as the firmware shows it: a value on the bottom row every
+// 200 ms, the countdown in the top right corner every second, then the result screen.
+
+#include <cstdio>
+
+#include "SimHost.h"
+#include "LcdFramebuffer.h"
+
+#define READING_MS 10000
+#define VALUE_PERIOD_MS 200
+#define COUNTDOWN_PERIOD_MS 1000
+
+struct ScreenStats
+{
+  uint32_t transactions;
+  uint32_t bytes;
+  std::string rows[2];
+};
+
+// PPM over a breath: a rise towards 1100 that levels off
+static double breathPPM(uint32_t ms) {
+  return 500 + 600 * (1 - exp(-(ms / 1500.0)));
+}
+
+// Draw the reading and result screens on 'display', calling flush() after every change
+template <typename DISPLAY, typename FLUSH>
+static ScreenStats drawSession(rgb_lcd &lcd, DISPLAY &display, FLUSH flush) {
+  char field[17];
+  lcd.clear();
+  simResetStats();
+
+  display.clear();
+  display.setCursor(0, 0);
+  display.print("READING...");
+  flush();
+
+  double sum = 0;
+  int count = 0;
+  double max = 0;
+  for (uint32_t ms = 0; ms < READING_MS; ms += VALUE_PERIOD_MS) {
+    if (ms % COUNTDOWN_PERIOD_MS == 0) {
+      snprintf(field, sizeof(field), "%02u", (unsigned)((READING_MS - ms) / 1000));
+      display.setCursor(14, 0);
+      display.print(field);
+    }
+
+    double ppm = breathPPM(ms);
+    snprintf(field, sizeof(field), "%8.2f", ppm);
+    display.setCursor(0, 1);
+    display.print("PPM:");
+    display.print(field);
+    flush();
+
+    sum += ppm;
+    count++;
+    max = ppm > max ? ppm : max;
+  }
+
+  display.clear();
+  display.setCursor(0, 0);
+  display.print("MAX PPM:");
+  snprintf(field, sizeof(field), "%6d", (int)max);
+  display.print(field);
+  display.setCursor(0, 1);
+  display.print("AVG PPM:");
+  snprintf(field, sizeof(field), "%6d", (int)(sum / count));
+  display.print(field);
+  flush();
+
+  ScreenStats stats;
+  stats.transactions = simStats().i2cTransactions;
+  stats.bytes = simStats().i2cBytesTo[LCD_ADDRESS];
+  stats.rows[0] = simLcdLine(0);
+  stats.rows[1] = simLcdLine(1);
+  return stats;
+}
+
+static void report(const char *name, const ScreenStats &stats) {
+  printf("%-28s %5u transactions %6u bytes  |%s|%s|\n", name, (unsigned)stats.transactions, (unsigned)stats.bytes,
+         stats.rows[0].c_str(), stats.rows[1].c_str());
+}
+
+int main() {
+  rgb_lcd lcd;
+  lcd.begin(LCD_COLS, LCD_ROWS);
+
+  ScreenStats direct = drawSession(lcd, lcd, []() {});
+  report("rgb_lcd directly", direct);
+
+  LcdFramebuffer framebuffer(lcd);
+  ScreenStats buffered = drawSession(lcd, framebuffer, [&framebuffer]() { framebuffer.flush(); });
+  report("LcdFramebuffer + flush()", buffered);
+
+  bool sameText = direct.rows[0] == buffered.rows[0] && direct.rows[1] == buffered.rows[1];
+  bool fewer = buffered.bytes < direct.bytes;
+  printf("framebuffer sends %.0f%% of the bytes\n", 100.0 * buffered.bytes / direct.bytes);
+  printf("  %-40s %s\n", "same text on the display", sameText ? "ok" : "FAILED");
+  printf("  %-40s %s\n", "fewer bytes through the framebuffer", fewer ? "ok" : "FAILED");
+  return sameText && fewer ? 0 : 1;
+}
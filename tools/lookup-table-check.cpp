@@ -0,0 +1,162 @@
+// Checks the compile-time BAC table in src/MQ3LookupTable.h against pow() in double precision
+// for every ADC code, and times a lookup against computing the same value.
+//
+//   g++ -std=gnu++14 -O2 -Isrc -o lookup-table-check tools/lookup-table-check.cpp src/FixedPoint.cpp
+//   ./lookup-table-check
+//
+// The table is built by constexpr ln/exp series rather than the C library, so this is what shows
+// they agree: every entry has to be within one LSB of the correctly rounded pow() result, for the
+// default profile and for a second, made-up calibration. Exit status is non-zero if any isn't.
+// The R0 correction a clean-air baseline applies on top of the table is checked the same way.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLE_COUNTER 1
+#endif
+
+#include "MQ3LookupTable.h"
+
+#define BENCH_SAMPLES 1000000
+#define BENCH_ROUNDS 5
+
+// A second sensor with a different calibration, to check the table follows the profile
+struct OtherProfile
+{
+  static constexpr double R0 = 412;
+  static constexpr double R2 = 2200;
+  static constexpr double EXPONENT = -1.52;
+};
+
+template <typename PROFILE>
+static double referenceQ(uint16_t raw) {
+  double x = (0.4 * PROFILE::R2 * (MQ3_ADC_MAX - raw)) / (PROFILE::R0 * raw);
+  return pow(x, PROFILE::EXPONENT) * 0.0001 * (1 << MQ3_LUT_BAC_FRAC_BITS);
+}
+
+template <typename PROFILE>
+static bool checkTable(const char *name) {
+  typedef MQ3Lookup<PROFILE> Lookup;
+  int64_t worst = 0;
+  uint16_t worstCode = 0;
+  uint16_t saturated = 0;
+
+  for (uint16_t raw = 1; raw < MQ3_ADC_MAX; raw++) {
+    double reference = referenceQ<PROFILE>(raw);
+    int64_t expected = reference >= INT32_MAX ? INT32_MAX : (int64_t)floor(reference + 0.5);
+    int64_t error = llabs(Lookup::bac(raw) - expected);
+    saturated += expected == INT32_MAX;
+    if (error > worst) {
+      worst = error;
+      worstCode = raw;
+    }
+  }
+  bool ends = Lookup::bac(0) == 0 && Lookup::bac(MQ3_ADC_MAX) == INT32_MAX && Lookup::bac(0xFFFF) == INT32_MAX;
+
+  bool ok = worst <= 1 && ends;
+  printf("%-20s worst %lld LSB", name, (long long)worst);
+  if (worst > 0) {
+    printf(" (code %u)", worstCode);
+  }
+  printf(", %u codes saturate, ends %s  %s\n", saturated, ends ? "ok" : "wrong", ok ? "ok" : "FAILED");
+  return ok;
+}
+
+// (R0 / R0')^exponent with R0' = RS at the baseline / MQ3_CLEAN_AIR_RATIO, in double precision
+template <typename PROFILE>
+static double referenceScale(uint16_t baselineRaw) {
+  double rs = PROFILE::R2 * (MQ3_ADC_MAX - baselineRaw) / (double)baselineRaw;
+  return pow(PROFILE::R0 * MQ3_CLEAN_AIR_RATIO / rs, PROFILE::EXPONENT);
+}
+
+template <typename PROFILE>
+static bool checkBaseline(const char *name) {
+  typedef MQ3Lookup<PROFILE> Lookup;
+  double worst = 0;
+  uint16_t worstCode = 0;
+
+  for (uint16_t baseline = 100; baseline <= 2000; baseline++) {
+    double scale = (double)Lookup::baselineScale(MQ3FixedConverter::ppm(baseline)) / (1 << MQ3_LUT_BAC_FRAC_BITS);
+    double error = fabs(scale / referenceScale<PROFILE>(baseline) - 1);
+    if (error > worst) {
+      worst = error;
+      worstCode = baseline;
+    }
+  }
+
+  // Clean air reading where R0 was measured leaves the table alone, and no baseline does too
+  uint16_t calibrated = (uint16_t)(MQ3_ADC_MAX * PROFILE::R2 / (PROFILE::R2 + PROFILE::R0 * MQ3_CLEAN_AIR_RATIO) + 0.5);
+  double atCalibration = (double)Lookup::baselineScale(MQ3FixedConverter::ppm(calibrated)) / (1 << MQ3_LUT_BAC_FRAC_BITS);
+  bool unchanged = fabs(atCalibration - referenceScale<PROFILE>(calibrated)) < 1e-5 && fabs(atCalibration - 1) < 0.01 &&
+                   Lookup::bac(1000, 0) == Lookup::bac(1000);
+
+  bool ok = worst < 1e-5 && unchanged;
+  printf("%-20s worst %.1e relative (baseline %u), %.4f at code %u  %s\n", name, worst, worstCode, atCalibration,
+         calibrated, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+template <typename CONVERT>
+static void bench(const char *name, const std::vector<uint16_t> &codes, CONVERT convert) {
+  double bestNs = 1e30;
+  double bestCycles = 1e30;
+  volatile int64_t sink = 0;
+
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    int64_t sum = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#ifdef HAVE_CYCLE_COUNTER
+    uint64_t startCycles = __rdtsc();
+#endif
+    for (size_t i = 0; i < codes.size(); i++) {
+      sum += convert(codes[i]);
+    }
+#ifdef HAVE_CYCLE_COUNTER
+    double cycles = (double)(__rdtsc() - startCycles) / codes.size();
+    if (cycles < bestCycles) {
+      bestCycles = cycles;
+    }
+#endif
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / codes.size();
+    if (ns < bestNs) {
+      bestNs = ns;
+    }
+    sink = sum;
+  }
+  (void)sink;
+
+#ifdef HAVE_CYCLE_COUNTER
+  printf("%-28s %7.2f cycles/sample %7.2f ns/sample\n", name, bestCycles, bestNs);
+#else
+  printf("%-28s %7.2f ns/sample\n", name, bestNs);
+#endif
+}
+
+int main() {
+  printf("every table entry against pow()\n");
+  bool ok = checkTable<MQ3DefaultProfile>("MQ3DefaultProfile");
+  ok &= checkTable<OtherProfile>("OtherProfile");
+
+  printf("\nR0 correction for a clean-air baseline of codes 100..2000 against pow()\n");
+  ok &= checkBaseline<MQ3DefaultProfile>("MQ3DefaultProfile");
+  ok &= checkBaseline<OtherProfile>("OtherProfile");
+
+  // Slowly drifting readings, like a breath, rather than random codes
+  std::vector<uint16_t> codes(BENCH_SAMPLES);
+  for (size_t i = 0; i < codes.size(); i++) {
+    codes[i] = 400 + (uint16_t)((i / 64) % 2000);
+  }
+
+  printf("\nlookup against compute\n");
+  bench("MQ3Lookup::bac() table", codes, [](uint16_t raw) { return (int64_t)MQ3Lookup<>::bac(raw); });
+  bench("MQ3Converter::bac() log2/exp2", codes, [](uint16_t raw) { return (int64_t)MQ3FixedConverter::bac(raw); });
+  bench("pow() double", codes, [](uint16_t raw) { return (int64_t)referenceQ<MQ3DefaultProfile>(raw); });
+
+  printf("%s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+// Walks every entry of the device's mode table (src/DeviceModes.cpp) on a PC with stand-in
+// actions, prints what each state/event pair does, checks the table hangs together, and times
+// StateMachine::dispatch().
+//
+//   g++ -std=gnu++14 -O2 -Isrc -o mode-table-check tools/mode-table-check.cpp src/DeviceModes.cpp
+//   ./mode-table-check
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "DeviceModes.h"
+
+static const char *MODE_NAMES[NUM_MODES] = { "WARMING_UP", "IDLE", "READING", "COOLDOWN" };
+static const char *EVENT_NAMES[NUM_MODE_EVENTS] = { "BUTTON", "TIMEOUT", "SAMPLES" };
+
+static std::string calls;
+static bool guardResult = true;
+static bool recording = true;
+static unsigned long guardCalls = 0;
+
+static void called(const char *name) {
+  if (recording) {
+    calls += calls.empty() ? "" : " ";
+    calls += name;
+  }
+}
+
+void enterWarmingUp() { called("enterWarmingUp"); }
+void updateWarmingUp() { called("updateWarmingUp"); }
+void finishWarmingUp() { called("finishWarmingUp"); }
+bool warmupSettled() { guardCalls++; return guardResult; }
+void enterIdle() { called("enterIdle"); }
+void updateIdle() { called("updateIdle"); }
+void enterReading() { called("enterReading"); }
+void updateReading() { called("updateReading"); }
+bool breathDone() { guardCalls++; return guardResult; }
+void enterCooldown() { called("enterCooldown"); }
+void stopModeTimers() { called("stopModeTimers"); }
+
+template <typename BODY>
+static double nsPerCall(long calls, BODY body) {
+  double best = 1e30;
+  for (int round = 0; round < 5; round++) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (long i = 0; i < calls; i++) {
+      body(i);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+    if (ns < best) {
+      best = ns;
+    }
+  }
+  return best;
+}
+
+int main() {
+  int problems = 0;
+  bool reachable[NUM_MODES] = { true };
+
+  for (uint8_t mode = 0; mode < NUM_MODES; mode++) {
+    for (uint8_t event = 0; event < NUM_MODE_EVENTS; event++) {
+      const StateTransition &transition = DEVICE_MODE_TRANSITIONS[mode][event];
+      for (int guard = 1; guard >= 0; guard--) {
+        if (guard == 0 && transition.guard == NULL) {
+          continue;
+        }
+
+        DeviceModeMachine machine(DEVICE_MODE_STATES, DEVICE_MODE_TRANSITIONS);
+        machine.start(mode);
+        calls.clear();
+        guardResult = guard;
+        bool changed = machine.dispatch(event);
+
+        printf("%-10s + %-7s%s -> %-10s %s\n", MODE_NAMES[mode], EVENT_NAMES[event],
+               transition.guard ? (guard ? " [yes]" : " [no] ") : "      ",
+               changed ? MODE_NAMES[machine.state()] : "(stays)", calls.c_str());
+
+        uint8_t expected = transition.target == STATE_NONE || !guard ? mode : transition.target;
+        if (machine.state() != expected || changed != (expected != mode)) {
+          printf("  expected %s\n", MODE_NAMES[expected]);
+          problems++;
+        }
+        if (transition.target != STATE_NONE && transition.target >= NUM_MODES) {
+          printf("  target out of range\n");
+          problems++;
+        }
+      }
+    }
+  }
+
+  // Every mode has to be reachable from power-up, and every mode has to have a way out
+  for (int pass = 0; pass < NUM_MODES; pass++) {
+    for (uint8_t mode = 0; mode < NUM_MODES; mode++) {
+      for (uint8_t event = 0; reachable[mode] && event < NUM_MODE_EVENTS; event++) {
+        uint8_t target = DEVICE_MODE_TRANSITIONS[mode][event].target;
+        if (target != STATE_NONE) {
+          reachable[target] = true;
+        }
+      }
+    }
+  }
+  for (uint8_t mode = 0; mode < NUM_MODES; mode++) {
+    bool exits = false;
+    for (uint8_t event = 0; event < NUM_MODE_EVENTS; event++) {
+      exits |= DEVICE_MODE_TRANSITIONS[mode][event].target != STATE_NONE;
+    }
+    if (!reachable[mode] || !exits) {
+      printf("%s is %s\n", MODE_NAMES[mode], !reachable[mode] ? "unreachable" : "a dead end");
+      problems++;
+    }
+  }
+
+  // Time the common cases: an event the mode ignores, the per-batch update plus SAMPLES with a
+  // guard that says no, and a full IDLE -> READING -> COOLDOWN -> IDLE round of transitions
+  recording = false;
+  DeviceModeMachine machine(DEVICE_MODE_STATES, DEVICE_MODE_TRANSITIONS);
+  machine.start(IDLE);
+  double ignoredNs = nsPerCall(10000000, [&](long) { machine.dispatch(MODE_EVENT_TIMEOUT); });
+
+  machine.start(READING);
+  guardResult = false;
+  double samplesNs = nsPerCall(10000000, [&](long) { machine.update(); machine.dispatch(MODE_EVENT_SAMPLES); });
+
+  machine.start(IDLE);
+  static const uint8_t ROUND[] = { MODE_EVENT_BUTTON, MODE_EVENT_TIMEOUT, MODE_EVENT_TIMEOUT };
+  double transitionNs = nsPerCall(9000000, [&](long i) { machine.dispatch(ROUND[i % 3]); });
+  if (machine.state() != IDLE) {
+    printf("round of transitions ended in %s\n", MODE_NAMES[machine.state()]);
+    problems++;
+  }
+
+  printf("\ndispatch, event ignored:        %5.1f ns\n", ignoredNs);
+  printf("update + guarded SAMPLES event: %5.1f ns\n", samplesNs);
+  printf("dispatch, transition taken:     %5.1f ns\n", transitionNs);
+  printf("problems: %d\n", problems);
+  return problems ? 1 : 0;
+}
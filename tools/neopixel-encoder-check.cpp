@@ -0,0 +1,244 @@
+// Checks the NeoPixel library's pixel encoding for every pixel type it supports: the bytes
+// setPixelColor() leaves in the frame buffer (what show() clocks out, first byte first),
+// getPixelColor() reading them back, and brightness scaling. Also checks show() on the virtual
+// clock from tools/sim/: a changed frame that comes before the last one has latched waits for a
+// later show() instead of spinning (the simulation aborts a pass that spins on micros()).
+//
+// The SPI output is checked on the bitstream itself: encodeSPI()'s output is decoded pulse by
+// pulse, each pulse's width held against the part's timing, and the bytes it carries compared
+// with what went in. The same goes for the frames a strip on setOutputSPI() hands to the mock
+// SPI, which also has to wait out the DMA frame and the latch without spinning.
+//
+//   g++ -std=gnu++14 -O2 -DPARTICLE -Itools/sim -Ilib/neopixel/src -o neopixel-encoder-check tools/neopixel-encoder-check.cpp tools/sim/SimHost.cpp lib/neopixel/src/neopixel.cpp
+//   ./neopixel-encoder-check
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "SimHost.h"
+#include "neopixel.h"
+
+#define PIXELS 3
+// Even values, so halving them for brightness is exact and can be undone
+#define R 0x12
+#define G 0x24
+#define B 0x36
+#define W 0x48
+#define PULSE_TOLERANCE_NS 150    // On a high (or for TM1829, low) time, as WS2812 datasheets give it
+#define PERIOD_TOLERANCE_NS 600   // On a whole bit
+
+// Bit timings are the spec figures quoted beside the bit-banging code in neopixel.cpp
+struct PixelType
+{
+  const char *name;
+  uint8_t type;
+  uint8_t bytesPerPixel;
+  uint8_t wire[4];        // R, G, B (and W) in the order they go out
+  uint32_t latchUs;
+  uint16_t oneNs;         // How long a 1 bit's pulse lasts
+  uint16_t zeroNs;        // And a 0 bit's
+  uint16_t bitNs;
+  bool inverted;          // Idles high and pulses low
+};
+
+static const PixelType types[] = {
+  {"WS2811", WS2811, 3, {R, G, B}, 50, 1200, 500, 2500, false},
+  {"WS2812/WS2812B/WS2813", WS2812B, 3, {G, R, B}, 300, 700, 350, 1250, false},
+  {"WS2812B2", WS2812B2, 3, {G, R, B}, 300, 700, 350, 1250, false},
+  {"WS2812B_FAST", WS2812B_FAST, 3, {G, R, B}, 50, 700, 350, 1250, false},
+  {"WS2812B2_FAST", WS2812B2_FAST, 3, {G, R, B}, 50, 700, 350, 1250, false},
+  {"TM1803", TM1803, 3, {R, G, B}, 24, 1360, 680, 2040, false},
+  {"TM1829", TM1829, 3, {R, B, G}, 500, 800, 300, 1100, true},
+  {"SK6812RGBW", SK6812RGBW, 4, {R, G, B, W}, 80, 600, 300, 1200, false},
+};
+
+// Every bit value in every position, and the colors used below
+static const uint8_t PATTERN[] = { 0x00, 0xFF, 0xA5, 0x5A, 0x0F, 0xF0, 0x01, 0x80, R, G, B, W };
+
+static int failures = 0;
+
+static void check(bool ok, const char *what) {
+  printf("  %-56s %s\n", what, ok ? "ok" : "FAILED");
+  if (!ok) {
+    failures++;
+  }
+}
+
+static bool frameIs(Adafruit_NeoPixel &strip, const PixelType &t, uint16_t n, const uint8_t *expected) {
+  static const uint8_t off[4] = {};
+  const uint8_t *pixels = strip.getPixels();
+  for (uint16_t i = 0; i < PIXELS; i++) {
+    if (memcmp(&pixels[i * t.bytesPerPixel], i == n ? expected : off, t.bytesPerPixel) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The 400 KHz parts' bits are twice as long, and so is the slack on them
+static uint32_t pulseTolerance(const PixelType &t) {
+  return t.bitNs > 2000 ? 2 * PULSE_TOLERANCE_NS : PULSE_TOLERANCE_NS;
+}
+
+// Decode an SPI bitstream back into bytes, one pulse per data bit. False if any bit isn't
+// a single pulse of the right width for a 0 or a 1, or the bit is too long or short.
+static bool decodeSPI(const PixelType &t, const std::vector<uint8_t> &stream, uint32_t clockHz,
+                      std::vector<uint8_t> &bytes) {
+  double spiBitNs = 1e9 / clockHz;
+  bytes.clear();
+  uint8_t byte = 0;
+  uint8_t bits = 0;
+  for (size_t i = 0; i < stream.size() * 2; i++) {
+    uint8_t nibble = (stream[i / 2] >> (i % 2 ? 0 : 4)) & 0xF;
+    if (t.inverted) {
+      nibble ^= 0xF;
+    }
+
+    // A run of active SPI bits from the start of the nibble, then idle to its end
+    uint8_t width = 0;
+    while (width < 4 && (nibble & (0x8 >> width))) {
+      width++;
+    }
+    if (width == 0 || (nibble & (0xF >> width)) != 0) {
+      return false;
+    }
+
+    double pulseNs = width * spiBitNs;
+    bool one = fabs(pulseNs - t.oneNs) < fabs(pulseNs - t.zeroNs);
+    if (fabs(pulseNs - (one ? t.oneNs : t.zeroNs)) > pulseTolerance(t) ||
+        fabs(NEO_SPI_BITS_PER_BIT * spiBitNs - t.bitNs) > PERIOD_TOLERANCE_NS) {
+      return false;
+    }
+
+    byte = (byte << 1) | one;
+    if (++bits == 8) {
+      bytes.push_back(byte);
+      byte = 0;
+      bits = 0;
+    }
+  }
+  return bits == 0;
+}
+
+static void checkSPI(const PixelType &t, uint32_t color) {
+  bool slow = t.type == WS2811 || t.type == TM1803;
+  uint32_t clockHz = slow ? NEO_SPI_CLOCK_400KHZ : NEO_SPI_CLOCK_800KHZ;
+  uint8_t stream[sizeof(PATTERN) * NEO_SPI_BITS_PER_BIT];
+  uint32_t length = Adafruit_NeoPixel::encodeSPI(PATTERN, sizeof(PATTERN), t.type, stream);
+  std::vector<uint8_t> decoded;
+  bool timed = decodeSPI(t, std::vector<uint8_t>(stream, stream + length), clockHz, decoded);
+  check(length == sizeof(stream), "encodeSPI() takes 4 SPI bits per data bit");
+  check(timed, "every SPI pulse is within the part's timing");
+  check(timed && decoded == std::vector<uint8_t>(PATTERN, PATTERN + sizeof(PATTERN)), "and carries the bits it was given");
+
+  // A strip on SPI sends its frame by DMA, and waits out that frame and the latch
+  Adafruit_NeoPixel strip(PIXELS, D3, t.type);
+  strip.begin();
+  check(strip.setOutputSPI(SPI), "setOutputSPI() takes the strip");
+  simClearSpiTransfers();
+  simAdvance(t.latchUs);
+  simBeginPass();
+  strip.setPixelColor(2, color);
+  strip.show();
+  const std::vector<SimSpiTransfer> &sent = simSpiTransfers();
+  const uint8_t *pixels = strip.getPixels();
+  std::vector<uint8_t> frame(pixels, pixels + PIXELS * t.bytesPerPixel);
+  bool framed = sent.size() == 1 && sent[0].dma && sent[0].clockHz == clockHz &&
+                decodeSPI(t, sent[0].data, sent[0].clockHz, decoded) && decoded == frame;
+  check(framed, "show() hands the frame to DMA, bit for bit");
+
+  uint64_t frameUs = (uint64_t)PIXELS * t.bytesPerPixel * 8 * NEO_SPI_BITS_PER_BIT * 1000000 / clockHz + 1;
+  strip.setPixelColor(2, 0);
+  strip.show();
+  bool held = sent.size() == 1;
+  simAdvance(frameUs + t.latchUs - 1);
+  simBeginPass();
+  strip.show();
+  held &= sent.size() == 1;
+  simAdvance(1);
+  simBeginPass();
+  strip.show();
+  check(held && sent.size() == 2, "a frame waits out the DMA frame and the latch");
+
+  strip.setOutputBitBang();
+  simAdvance(frameUs + t.latchUs);
+  simBeginPass();
+  strip.setPixelColor(2, color);
+  strip.show();
+  check(sent.size() == 2, "setOutputBitBang() leaves SPI alone");
+}
+
+static void checkType(const PixelType &t) {
+  printf("%s\n", t.name);
+  bool rgbw = t.bytesPerPixel == 4;
+  uint32_t color = rgbw ? Adafruit_NeoPixel::Color(R, G, B, W) : Adafruit_NeoPixel::Color(R, G, B);
+
+  Adafruit_NeoPixel packed(PIXELS, D3, t.type);
+  packed.setPixelColor(1, color);
+  check(frameIs(packed, t, 1, t.wire), "packed color lands in wire order");
+  check(packed.getPixelColor(1) == color, "getPixelColor() reads it back");
+
+  Adafruit_NeoPixel separate(PIXELS, D3, t.type);
+  if (rgbw) {
+    separate.setPixelColor(1, R, G, B, W);
+  } else {
+    separate.setPixelColor(1, R, G, B);
+  }
+  check(frameIs(separate, t, 1, t.wire), "separate components match");
+
+  // Brightness 127 is stored as 128, so every byte comes out halved
+  Adafruit_NeoPixel dimmed(PIXELS, D3, t.type);
+  dimmed.setBrightness(127);
+  dimmed.setPixelColor(1, color);
+  uint8_t halved[4];
+  for (uint8_t i = 0; i < t.bytesPerPixel; i++) {
+    halved[i] = t.wire[i] / 2;
+  }
+  check(frameIs(dimmed, t, 1, halved), "brightness scales every byte");
+  check(dimmed.getPixelColor(1) == color, "getPixelColor() undoes the scaling");
+
+  if (t.type == TM1829) {
+    Adafruit_NeoPixel full(PIXELS, D3, t.type);
+    full.setPixelColor(0, 255, 0, 0);
+    check(full.getPixels()[0] == 254, "full red is held at 254");
+  }
+
+  // show() and the latch
+  Adafruit_NeoPixel strip(PIXELS, D3, t.type);
+  strip.begin();
+  simAdvance(t.latchUs);
+  simBeginPass();
+  strip.setPixelColor(0, color);
+  strip.show();
+  bool sent = !strip.canShow();
+  strip.setPixelColor(0, 0);
+  strip.show();
+  simAdvance(t.latchUs - 1);
+  simBeginPass();
+  bool latching = !strip.canShow();
+  strip.show();
+  simAdvance(1);
+  bool latched = strip.canShow();
+  simBeginPass();
+  strip.show();
+  bool resent = !strip.canShow();
+  simAdvance(t.latchUs);
+  simBeginPass();
+  strip.show();
+  check(sent && latching && latched, "the latch lasts exactly as long as the type needs");
+  check(resent, "a frame held back by the latch goes out after it");
+  check(strip.canShow(), "an unchanged frame isn't sent again");
+
+  checkSPI(t, color);
+}
+
+int main() {
+  for (const PixelType &t : types) {
+    checkType(t);
+  }
+
+  printf("%s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
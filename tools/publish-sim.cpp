@@ -0,0 +1,130 @@
+// Runs the firmware's PublishQueue against a stand-in for Particle.publish on a virtual clock,
+// with the cloud dropping out now and then, and reports what it costs on the wire.
+//
+//   g++ -std=gnu++14 -O2 -Isrc -o publish-sim tools/publish-sim.cpp src/PublishQueue.cpp
+//   ./publish-sim [hours] [results per hour] [% of time offline] [% of sends lost]
+//
+// Sends are NO_ACK like the firmware's: each one is settled at the next flush, and a lost one
+// has to go out again. Every event that arrives is decoded and checked against what was
+// queued, so a result that gets lost, duplicated or mangled along the way shows up as a
+// mismatch.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+
+#include "PublishQueue.h"
+
+#define FLUSH_PERIOD_MS 10000   // PUBLISH_FLUSH_PERIOD in the firmware
+#define OUTAGE_MS 600000        // Typical length of one outage
+
+static std::deque<PublishRecord> expected;
+static unsigned long events = 0;
+static unsigned long bytes = 0;
+static unsigned long results = 0;
+static unsigned long mismatches = 0;
+static unsigned long lost = 0;
+static std::string inFlight;
+
+static bool sameRecord(const PublishRecord &a, const PublishRecord &b) {
+  return a.timestamp == b.timestamp && a.maxPPM == b.maxPPM && a.avgPPM == b.avgPPM &&
+         a.maxBAC == b.maxBAC && a.avgBAC == b.avgBAC && a.duration == b.duration;
+}
+
+static bool publishSink(const char *payload) {
+  inFlight = payload;
+  return true;
+}
+
+static void arrive(const char *payload) {
+  PublishRecord records[PUBLISH_QUEUE_SLOTS];
+  uint8_t count = PublishQueue::decode(payload, records, PUBLISH_QUEUE_SLOTS);
+
+  events++;
+  bytes += strlen(payload);
+  results += count;
+  for (uint8_t i = 0; i < count; i++) {
+    if (expected.empty() || !sameRecord(expected.front(), records[i])) {
+      mismatches++;
+    } else {
+      expected.pop_front();
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  double hours = argc > 1 ? atof(argv[1]) : 24;
+  double perHour = argc > 2 ? atof(argv[2]) : 20;
+  double offlinePercent = argc > 3 ? atof(argv[3]) : 20;
+  double lostPercent = argc > 4 ? atof(argv[4]) : 5;
+
+  PublishStore store;
+  memset(&store, 0xFF, sizeof(store));  // Whatever backup RAM holds after power-up
+  PublishQueue queue(store);
+  queue.begin();
+
+  srand(1);
+  uint64_t endMs = (uint64_t)(hours * 3600000);
+  uint64_t onlineUntil = 0;
+  uint64_t offlineUntil = 0;
+  uint64_t nextResult = 0;
+  uint32_t epoch = 1700000000;
+  unsigned long queued = 0;
+  uint8_t maxPending = 0;
+
+  for (uint64_t now = 0; now < endMs; now += FLUSH_PERIOD_MS) {
+    // Alternate online and offline stretches so the requested share of time is spent offline
+    if (now >= offlineUntil && now >= onlineUntil) {
+      uint64_t online = offlinePercent > 0 ? (uint64_t)(OUTAGE_MS * (100 - offlinePercent) / offlinePercent) : endMs;
+      onlineUntil = now + online;
+      offlineUntil = onlineUntil + (offlinePercent > 0 ? OUTAGE_MS : 0);
+    }
+    bool online = now < onlineUntil;
+
+    // Last flush's send has gone out, or hasn't
+    if (queue.inFlight()) {
+      if (rand() % 10000 < lostPercent * 100) {
+        queue.undelivered();
+        lost++;
+      } else {
+        arrive(inFlight.c_str());
+        queue.delivered();
+      }
+    }
+
+    while (perHour > 0 && nextResult <= now) {
+      PublishRecord record;
+      record.timestamp = epoch + (uint32_t)(nextResult / 1000);
+      record.avgPPM = 20 + rand() % 400;
+      record.maxPPM = record.avgPPM + rand() % 300;
+      record.avgBAC = record.avgPPM * 40;
+      record.maxBAC = record.maxPPM * 40;
+      record.duration = 50 + rand() % 50;
+      queue.push(record);
+      expected.push_back(record);
+      if (expected.size() > PUBLISH_QUEUE_SLOTS) {
+        expected.pop_front();   // The queue drops its oldest result the same way
+      }
+      queued++;
+      nextResult += (uint64_t)(3600000 / perHour * (0.5 + rand() / (double)RAND_MAX));
+    }
+
+    if (queue.pending() > maxPending) {
+      maxPending = queue.pending();
+    }
+    if (online && queue.pending()) {
+      queue.flush(publishSink);
+    }
+  }
+
+  double minutes = hours * 60;
+  printf("%.1f h, %lu results queued, %lu published, %lu dropped, %u still pending\n",
+         hours, queued, results, (unsigned long)queue.dropped(), queue.pending());
+  printf("events: %lu (%.3f/min) and %lu lost, most pending at once: %u\n", events, events / minutes, lost, maxPending);
+  printf("bytes per result: %.1f (%.1f per event)\n",
+         results ? (double)bytes / results : 0.0, events ? (double)bytes / events : 0.0);
+  printf("mismatches: %lu\n", mismatches);
+  return mismatches ? 1 : 0;
+}
@@ -0,0 +1,116 @@
+// Runs the firmware's MQ3Sampler against a mock ADC on the virtual clock from tools/sim/ and
+// checks its sample cadence and what happens when loop() falls behind.
+//
+//   g++ -std=gnu++14 -O2 -DPARTICLE -Itools/sim -Isrc -o sampler-check tools/sampler-check.cpp tools/sim/SimHost.cpp src/MQ3Sampler.cpp
+//   ./sampler-check
+//
+// The mock ADC returns a running count and notes when it was read, so every sample can be
+// traced back to its conversion: the reads have to be exactly one period apart however late
+// loop() drains them, and the samples have to come out in order with none lost or repeated
+// until the ring is full. Past that, each sample that doesn't fit has to be counted once.
+
+#include <cstdio>
+#include <vector>
+
+#include "SimHost.h"
+#include "MQ3Sampler.h"
+
+#define PERIOD_MS 20          // MS_BETWEEN_SAMPLES in the firmware
+#define DRAIN_BATCH 16        // SAMPLE_BATCH_SIZE in the firmware
+#define MQ3_PIN A1
+
+static std::vector<uint64_t> readTimes;
+static int failures = 0;
+
+static int32_t countingAdc(pin_t pin, uint64_t nowUs) {
+  readTimes.push_back(nowUs);
+  return (int32_t)(readTimes.size() & 0xFFF);
+}
+
+static void check(bool ok, const char *what) {
+  printf("  %-56s %s\n", what, ok ? "ok" : "FAILED");
+  if (!ok) {
+    failures++;
+  }
+}
+
+static uint32_t nextRandom() {
+  static uint32_t seed = 7;
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8;
+}
+
+// Drain everything queued, checking it continues the count from 'expected'
+static bool drainInOrder(MQ3Sampler &sampler, uint32_t &expected) {
+  uint16_t batch[DRAIN_BATCH];
+  uint16_t count;
+  bool inOrder = true;
+  while ((count = sampler.drain(batch, DRAIN_BATCH)) > 0) {
+    for (uint16_t i = 0; i < count; i++) {
+      inOrder &= batch[i] == (expected & 0xFFF);
+      expected++;
+    }
+  }
+  return inOrder;
+}
+
+int main() {
+  simSetAnalogSource(countingAdc);
+  MQ3Sampler sampler(MQ3_PIN, PERIOD_MS);
+
+  printf("cadence, with loop() passes from 1 to 1000 ms\n");
+  sampler.begin();
+  uint32_t expected = 1;
+  bool inOrder = true;
+  uint16_t deepest = 0;
+  while (simMicros() < 60000000ULL) {
+    simAdvance(1000 * (1 + nextRandom() % 1000));
+    if (sampler.pending() > deepest) {
+      deepest = sampler.pending();
+    }
+    inOrder &= drainInOrder(sampler, expected);
+  }
+
+  bool evenlySpaced = true;
+  for (size_t i = 1; i < readTimes.size(); i++) {
+    evenlySpaced &= readTimes[i] - readTimes[i - 1] == PERIOD_MS * 1000;
+  }
+  printf("  %u samples, up to %u queued at once\n", (unsigned)readTimes.size(), deepest);
+  check(readTimes.size() == simMicros() / (PERIOD_MS * 1000), "one sample per period");
+  check(evenlySpaced, "reads exactly one period apart");
+  check(inOrder && expected == readTimes.size() + 1, "every sample comes out once, in order");
+  check(sampler.droppedSamples() == 0, "nothing dropped");
+
+  printf("overflow, loop() stalled for 3 s\n");
+  uint32_t before = readTimes.size();
+  simAdvance(3000000);
+  uint32_t taken = readTimes.size() - before;
+  uint32_t dropped = sampler.droppedSamples();
+  printf("  %u samples taken, %u queued, %u dropped\n", taken, sampler.pending(), dropped);
+  check(sampler.pending() == MQ3_SAMPLE_BUFFER_SIZE, "the ring fills up");
+  check(dropped == taken - MQ3_SAMPLE_BUFFER_SIZE, "every sample that didn't fit is counted");
+  check(drainInOrder(sampler, expected), "the queued samples are the oldest, in order");
+
+  // Sampling carries on from the first sample after the stall
+  expected = readTimes.size() + 1;
+  simAdvance(1000000);
+  check(drainInOrder(sampler, expected) && expected == readTimes.size() + 1, "sampling recovers");
+  check(sampler.droppedSamples() == dropped, "no more drops once drained");
+
+  printf("flush\n");
+  simAdvance(500000);
+  sampler.flush();
+  check(sampler.pending() == 0, "flush() empties the ring");
+  expected = readTimes.size() + 1;
+  simAdvance(100000);
+  check(drainInOrder(sampler, expected) && expected == readTimes.size() + 1, "only new samples after flush()");
+
+  printf("stop\n");
+  sampler.stop();
+  uint32_t stoppedAt = readTimes.size();
+  simAdvance(1000000);
+  check(readTimes.size() == stoppedAt, "no reads once stopped");
+
+  printf("%s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,273 @@
+// Drives TaskScheduler (src/TaskScheduler.cpp) off a virtual millisecond clock and checks when
+// its tasks run: exact cadence, what a late or stalled loop() does to the run and deadline
+// counts, one-shots, tasks that stop or restart themselves, and millis() wrapping. Last, a long
+// run of random start()/stop() calls and uneven loop() passes is checked pass by pass against a
+// plain list-based model of the same rules, so the heap has to agree with it on every run.
+//
+//   g++ -std=gnu++14 -O2 -Isrc -o scheduler-check tools/scheduler-check.cpp src/TaskScheduler.cpp
+//   ./scheduler-check
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "TaskScheduler.h"
+
+#define CADENCE_MS 60000
+#define RANDOM_PASSES 200000
+
+static TaskScheduler *current = NULL;
+static std::vector<TaskId> ran;
+static TaskId selfStopping = TASK_INVALID;
+static TaskId selfRestarting = TASK_INVALID;
+static uint32_t now = 0;
+static int failures = 0;
+
+static void check(bool ok, const char *what) {
+  printf("  %-56s %s\n", what, ok ? "ok" : "FAILED");
+  if (!ok) {
+    failures++;
+  }
+}
+
+static uint32_t nextRandom() {
+  static uint32_t seed = 11;
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8;
+}
+
+// One callback per task slot, so the log says which task ran
+template <TaskId ID>
+static void task() {
+  ran.push_back(ID);
+  if (ID == selfStopping) {
+    current->stop(ID);
+  }
+  if (ID == selfRestarting) {
+    current->start(ID, 5, now);
+  }
+}
+
+static const TaskCallback CALLBACKS[SCHEDULER_MAX_TASKS] = {
+  task<0>, task<1>, task<2>, task<3>, task<4>, task<5>,
+  task<6>, task<7>, task<8>, task<9>, task<10>, task<11>,
+};
+
+static uint32_t runsOf(TaskId id) {
+  return std::count(ran.begin(), ran.end(), id);
+}
+
+// Every pass 'step' ms apart until 'until'
+static void runUntil(TaskScheduler &scheduler, uint32_t until, uint32_t step) {
+  while ((int32_t)(until - now) > 0) {
+    now += step;
+    scheduler.run(now);
+  }
+}
+
+static void cadence() {
+  printf("cadence, one pass every millisecond\n");
+  TaskScheduler scheduler;
+  current = &scheduler;
+  ran.clear();
+  now = 0;
+  const uint32_t periods[] = { 20, 50, 1000 };
+  for (TaskId id = 0; id < 3; id++) {
+    scheduler.add(CALLBACKS[id], periods[id]);
+    scheduler.start(id, periods[id], now);
+  }
+  runUntil(scheduler, CADENCE_MS, 1);
+
+  bool exact = true;
+  bool onTime = true;
+  for (TaskId id = 0; id < 3; id++) {
+    exact &= runsOf(id) == CADENCE_MS / periods[id];
+    onTime &= scheduler.stats(id).maxLatenessMs == 0 && scheduler.stats(id).skippedPeriods == 0;
+  }
+  check(exact, "every task runs once per period");
+  check(onTime && scheduler.deadlineMisses() == 0, "none of them late");
+  check(scheduler.timeUntilNext(now) == 20, "timeUntilNext() points at the 20 ms task");
+}
+
+static void lateLoop() {
+  printf("uneven passes, then a stalled one\n");
+  TaskScheduler scheduler;
+  current = &scheduler;
+  ran.clear();
+  now = 0;
+  TaskId id = scheduler.add(CALLBACKS[0], 20);
+  scheduler.start(id, 20, now);
+
+  // Passes up to 15 ms apart are late but never by a whole period
+  while (now < CADENCE_MS) {
+    now += 1 + nextRandom() % 15;
+    scheduler.run(now);
+  }
+  TaskStats stats = scheduler.stats(id);
+  check(stats.runs == now / 20 && stats.skippedPeriods == 0, "late passes don't lose or add runs");
+  check(stats.deadlineMisses == 0 && stats.maxLatenessMs < 15, "nor count as deadline misses");
+
+  // One pass 250 ms after the last: a single run, a miss, and the periods in between skipped
+  uint32_t runs = stats.runs;
+  now += 250;
+  scheduler.run(now);
+  stats = scheduler.stats(id);
+  check(stats.runs == runs + 1, "a stall runs the task once, not in a burst");
+  check(stats.deadlineMisses == 1, "and counts one deadline miss");
+  check(stats.runs + stats.skippedPeriods == now / 20, "the periods it slept through are counted skipped");
+  check(scheduler.timeUntilNext(now) == 20 - now % 20, "and it stays on the 20 ms grid");
+}
+
+static void oneShots() {
+  printf("one-shots\n");
+  TaskScheduler scheduler;
+  current = &scheduler;
+  ran.clear();
+  now = 0;
+  TaskId onTime = scheduler.add(CALLBACKS[0], 0);
+  TaskId late = scheduler.add(CALLBACKS[1], 0);
+  TaskId custom = scheduler.add(CALLBACKS[2], 0, 100);
+  scheduler.start(onTime, 30, now);
+  scheduler.start(late, 30, now);
+  scheduler.start(custom, 30, now);
+  scheduler.run(30);
+
+  // Again, due at 30 but first looked at just past its deadline
+  scheduler.start(late, 0, 30);
+  now = 30 + TASK_ONE_SHOT_DEADLINE_MS + 1;
+  scheduler.run(now);
+  runUntil(scheduler, 1000, 1);
+  check(runsOf(onTime) == 1 && runsOf(late) == 2 && runsOf(custom) == 1, "each start() runs once");
+  check(!scheduler.isActive(onTime) && scheduler.timeUntilNext(now) == UINT32_MAX, "and leaves nothing scheduled");
+  check(scheduler.stats(late).deadlineMisses == 1, "later than TASK_ONE_SHOT_DEADLINE_MS is a miss");
+
+  TaskScheduler patient;
+  ran.clear();
+  TaskId relaxed = patient.add(CALLBACKS[0], 0, 100);
+  patient.start(relaxed, 10, 0);
+  patient.run(100);
+  check(patient.stats(relaxed).deadlineMisses == 0, "an explicit deadline replaces the default");
+}
+
+static void selfControl() {
+  printf("tasks that stop or restart themselves\n");
+  TaskScheduler scheduler;
+  current = &scheduler;
+  ran.clear();
+  now = 0;
+  selfStopping = scheduler.add(CALLBACKS[0], 10);
+  selfRestarting = scheduler.add(CALLBACKS[1], 10);
+  scheduler.start(selfStopping, 10, now);
+  scheduler.start(selfRestarting, 10, now);
+  runUntil(scheduler, 1000, 1);
+  check(runsOf(selfStopping) == 1 && !scheduler.isActive(selfStopping), "stop() from its own callback sticks");
+  check(runsOf(selfRestarting) == 1 + (1000 - 10) / 5, "start() from its own callback replaces the period");
+  selfStopping = selfRestarting = TASK_INVALID;
+
+  TaskScheduler full;
+  bool added = true;
+  for (TaskId id = 0; id < SCHEDULER_MAX_TASKS; id++) {
+    added &= full.add(CALLBACKS[id], 10) == id;
+  }
+  check(added && full.add(CALLBACKS[0], 10) == TASK_INVALID, "add() refuses a task past SCHEDULER_MAX_TASKS");
+}
+
+static void wrap() {
+  printf("millis() wrapping\n");
+  TaskScheduler scheduler;
+  current = &scheduler;
+  ran.clear();
+  now = UINT32_MAX - 95;
+  TaskId id = scheduler.add(CALLBACKS[0], 20);
+  scheduler.start(id, 20, now);
+  runUntil(scheduler, now + 1000, 1);
+  TaskStats stats = scheduler.stats(id);
+  check(stats.runs == 50 && stats.deadlineMisses == 0 && stats.maxLatenessMs == 0, "runs straight through the wrap");
+}
+
+// The rules TaskScheduler is meant to follow, kept as a plain list
+struct ModelTask
+{
+  bool active;
+  uint32_t due;
+  uint32_t periodMs;
+};
+
+static void modelRun(std::vector<ModelTask> &tasks, uint32_t at, std::vector<TaskId> &out) {
+  for (TaskId id = 0; id < tasks.size(); id++) {
+    ModelTask &t = tasks[id];
+    if (!t.active || (int32_t)(at - t.due) < 0) {
+      continue;
+    }
+    out.push_back(id);
+    if (t.periodMs) {
+      t.due += t.periodMs;
+      if ((int32_t)(at - t.due) >= 0) {
+        t.due += ((at - t.due) / t.periodMs + 1) * t.periodMs;
+      }
+    } else {
+      t.active = false;
+    }
+  }
+}
+
+static void againstModel() {
+  printf("random start()/stop() against a model, %d passes\n", RANDOM_PASSES);
+  TaskScheduler scheduler;
+  current = &scheduler;
+  now = 1000;
+  std::vector<ModelTask> model(SCHEDULER_MAX_TASKS);
+  for (TaskId id = 0; id < SCHEDULER_MAX_TASKS; id++) {
+    // A few one-shots among periods from 1 ms to 2 s
+    uint32_t period = id % 4 == 3 ? 0 : 1 + nextRandom() % 2000;
+    scheduler.add(CALLBACKS[id], period);
+    model[id].active = false;
+    model[id].periodMs = period;
+  }
+
+  uint32_t mismatches = 0;
+  uint32_t runs = 0;
+  for (uint32_t pass = 0; pass < RANDOM_PASSES; pass++) {
+    if (nextRandom() % 8 == 0) {
+      TaskId id = nextRandom() % SCHEDULER_MAX_TASKS;
+      if (nextRandom() % 3 == 0) {
+        scheduler.stop(id);
+        model[id].active = false;
+      } else {
+        uint32_t delay = nextRandom() % 500;
+        scheduler.start(id, delay, now);
+        model[id].active = true;
+        model[id].due = now + delay;
+      }
+    }
+
+    now += nextRandom() % 40;
+    ran.clear();
+    scheduler.run(now);
+    std::vector<TaskId> expected;
+    modelRun(model, now, expected);
+
+    // Tasks due in the same pass may come out in any order
+    std::sort(ran.begin(), ran.end());
+    mismatches += ran != expected;
+    runs += ran.size();
+
+    for (TaskId id = 0; id < SCHEDULER_MAX_TASKS; id++) {
+      mismatches += scheduler.isActive(id) != model[id].active;
+    }
+  }
+  printf("  %u runs\n", (unsigned)runs);
+  check(mismatches == 0, "the heap runs exactly what the model does");
+}
+
+int main() {
+  cadence();
+  lateLoop();
+  oneShots();
+  selfControl();
+  wrap();
+  againstModel();
+
+  printf("%s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
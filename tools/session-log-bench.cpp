@@ -0,0 +1,214 @@
+// Runs the firmware's SessionLog on a memory-mapped file standing in for the Photon's EEPROM,
+// checks it recovers from a reset in the middle of an append and that count() agrees with query(),
+// and times appends and queries.
+//
+//   g++ -std=gnu++14 -O2 -Isrc -o session-log-bench tools/session-log-bench.cpp src/SessionLog.cpp
+//   ./session-log-bench [eeprom.bin] [appends]
+//
+// The file keeps its contents between runs, so running it twice also shows begin() picking up
+// a log that was left behind.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "SessionLog.h"
+
+static uint8_t *eeprom = NULL;
+static long writesLeft = -1;    // Byte writes until the simulated reset, -1 for never
+static unsigned long visited = 0;
+static unsigned long unsyncedVisited = 0;
+
+static void readEeprom(uint16_t address, uint8_t *data, uint16_t length) {
+  memcpy(data, &eeprom[address], length);
+}
+
+// Byte at a time like the emulated EEPROM, so a reset can land anywhere in a record
+static void writeEeprom(uint16_t address, const uint8_t *data, uint16_t length) {
+  for (uint16_t i = 0; i < length; i++) {
+    if (writesLeft == 0) {
+      return;
+    }
+    if (writesLeft > 0) {
+      writesLeft--;
+    }
+    eeprom[address + i] = data[i];
+  }
+}
+
+static void countRecord(const SessionLogRecord &) {
+  visited++;
+}
+
+static void checkSynced(const SessionLogRecord &record) {
+  unsyncedVisited += record.timestamp == 0;
+}
+
+static SessionLogRecord makeRecord(uint32_t time) {
+  SessionLogRecord record;
+  memset(&record, 0, sizeof(record));
+  record.timestamp = time;
+  record.avgPPM = 20 + rand() % 400;
+  record.maxPPM = record.avgPPM + rand() % 300;
+  record.avgBAC = record.avgPPM * 40;
+  record.maxBAC = record.maxPPM * 40;
+  record.duration = 50 + rand() % 50;
+  return record;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+  const char *path = argc > 1 ? argv[1] : "eeprom.bin";
+  long appends = argc > 2 ? atol(argv[2]) : 100000;
+
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    perror(path);
+    return 2;
+  }
+  struct stat info;
+  bool fresh = fstat(fd, &info) == 0 && info.st_size < EEPROM_SIZE;
+  if (ftruncate(fd, EEPROM_SIZE) != 0) {
+    perror(path);
+    return 2;
+  }
+  eeprom = (uint8_t *)mmap(NULL, EEPROM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (eeprom == MAP_FAILED) {
+    perror("mmap");
+    return 2;
+  }
+  if (fresh) {
+    memset(eeprom, 0xFF, EEPROM_SIZE);    // Erased flash
+  }
+
+  SessionLog log(readEeprom, writeEeprom);
+  uint8_t found = log.begin();
+  printf("found %u records, last sequence %u\n", found, (unsigned)log.lastSequence());
+
+  uint32_t time = 1700000000 + log.lastSequence() * 600;
+  int failures = 0;
+
+  // Reset part way through every byte of one append and check nothing but that record is lost
+  for (long cut = 0; cut <= (long)sizeof(SessionLogRecord) + 1; cut++) {
+    uint32_t before = log.lastSequence();
+    uint8_t beforeCount = log.count();
+    writesLeft = cut;
+    log.append(makeRecord(time += 600));
+    writesLeft = -1;
+
+    log.begin();
+    bool complete = cut > (long)sizeof(SessionLogRecord);
+    uint32_t expected = complete ? before + 1 : before;
+    uint8_t minimum = beforeCount == log.capacity() && !complete ? beforeCount - 1 : beforeCount;
+    if (log.lastSequence() != expected || log.count() < minimum) {
+      printf("reset after %ld bytes: sequence %u (expected %u), %u records\n",
+             cut, (unsigned)log.lastSequence(), (unsigned)expected, log.count());
+      failures++;
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < appends; i++) {
+    log.append(makeRecord(time += 600));
+  }
+  double appendSeconds = secondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  const int rescans = 1000;
+  for (int i = 0; i < rescans; i++) {
+    log.begin();
+  }
+  double scanSeconds = secondsSince(start) / rescans;
+
+  // Every window of one day across what is in the log
+  SessionLogRecord oldest;
+  log.get(0, oldest);
+  start = std::chrono::steady_clock::now();
+  long queries = 0;
+  for (uint32_t from = oldest.timestamp; from <= time; from += 3600, queries++) {
+    log.query(from, from + 86400, countRecord);
+  }
+  double querySeconds = secondsSince(start);
+
+  // count() has to agree with what query() visits
+  for (uint32_t from = oldest.timestamp; from <= time; from += 3600) {
+    if (log.count(from, from + 86400) != log.query(from, from + 86400, [](const SessionLogRecord &) {})) {
+      printf("count() disagrees with query() from %u\n", (unsigned)from);
+      failures++;
+    }
+  }
+  if (log.count(0, UINT32_MAX) != log.count()) {
+    printf("count() over everything isn't the whole log\n");
+    failures++;
+  }
+
+  // Records from before the clock was synced and from after it was set back, in a scratch log
+  // so the file's is left as it was. count() and query() have to agree on them as appended and
+  // as begin() finds them again.
+  std::vector<uint8_t> scratch(EEPROM_SIZE, 0xFF);
+  uint8_t *file = eeprom;
+  eeprom = scratch.data();
+  SessionLog mixed(readEeprom, writeEeprom);
+  mixed.begin();
+  uint32_t stamp = 1700000000;
+  for (int i = 0; i < 3 * SESSION_LOG_SLOTS / 2; i++) {
+    SessionLogRecord record = makeRecord(stamp += 600);
+    if (i % 7 == 0) {
+      record.timestamp = 0;
+    } else if (i % 11 == 0) {
+      record.timestamp -= 1500;
+    }
+    mixed.append(record);
+  }
+  for (int pass = 0; pass < 2; pass++) {
+    uint32_t windows[][2] = { { 0, UINT32_MAX }, { 0, stamp - 20000 }, { stamp - 30000, UINT32_MAX } };
+    bool agree = true;
+    for (auto &window : windows) {
+      agree &= mixed.count(window[0], window[1]) == mixed.query(window[0], window[1], checkSynced);
+    }
+    for (uint32_t from = stamp - SESSION_LOG_SLOTS * 600; from <= stamp; from += 700) {
+      agree &= mixed.count(from, from + 5000) == mixed.query(from, from + 5000, checkSynced);
+    }
+    uint8_t unsynced = mixed.query(0, UINT32_MAX, [](const SessionLogRecord &) {}) -
+                       mixed.query(1, UINT32_MAX, [](const SessionLogRecord &) {});
+    unsyncedVisited = 0;
+    mixed.query(1, UINT32_MAX, checkSynced);
+    if (!agree || unsynced == 0 || unsyncedVisited != 0) {
+      printf("unsynced records: count() and query() disagree%s\n", pass ? " after begin()" : "");
+      failures++;
+    }
+    mixed.begin();
+  }
+  eeprom = file;
+
+  // The full log has to come back in order
+  SessionLogRecord previous, record;
+  for (uint8_t n = 1; n < log.count(); n++) {
+    log.get(n - 1, previous);
+    log.get(n, record);
+    if (record.sequence != previous.sequence + 1 || record.timestamp < previous.timestamp) {
+      printf("records %u and %u out of order\n", n - 1, n);
+      failures++;
+    }
+  }
+
+  printf("%u/%u slots used, last sequence %u\n", log.count(), log.capacity(), (unsigned)log.lastSequence());
+  printf("append: %.0f records/s\n", appends / appendSeconds);
+  printf("scan: %.1f us per begin()\n", scanSeconds * 1e6);
+  printf("query: %.2f us per day-long range, %lu records visited\n", querySeconds * 1e6 / queries, visited);
+  printf("failures: %d\n", failures);
+
+  munmap(eeprom, EEPROM_SIZE);
+  close(fd);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,332 @@
+// Host stand-in for the parts of Device OS the firmware uses, so the sketch and its libraries
+// build and run on Linux (see tools/firmware-sim.cpp). Time is virtual: it only moves when the
+// simulation advances it (SimHost.h), or when the firmware waits in delay(), delayMicroseconds()
+// or a Wire transaction, all of which the host counts. Timers and pin interrupts fire from the
+// clock as it moves.
+//
+// PLATFORM_ID 3 is Device OS's own "gcc" virtual device, which the libraries treat as having no
+// real GPIO to drive.
+
+#ifndef SIM_PARTICLE_H
+#define SIM_PARTICLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <functional>
+#include <string>
+
+#define PARTICLE_SIM 1
+#define PLATFORM_ID 3
+
+typedef uint8_t byte;
+typedef uint16_t pin_t;
+
+#define LOW 0
+#define HIGH 1
+
+enum PinMode { INPUT, OUTPUT, INPUT_PULLUP, INPUT_PULLDOWN };
+enum InterruptMode { CHANGE, RISING, FALLING };
+
+#define D0 0
+#define D1 1
+#define D2 2
+#define D3 3
+#define D4 4
+#define D5 5
+#define D6 6
+#define D7 7
+#define A0 10
+#define A1 11
+#define A2 12
+#define A3 13
+#define A4 14
+#define A5 15
+#define SIM_PIN_COUNT 20
+
+#define retained
+#define STARTUP(code) static int sim_startup_ = ((code), 0);
+#define SYSTEM_THREAD(x)
+#define SINGLE_THREADED_BLOCK()
+#define ATOMIC_BLOCK()
+
+// Time and pins
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(pin_t pin, PinMode mode);
+void digitalWrite(pin_t pin, uint8_t value);
+int32_t digitalRead(pin_t pin);
+int32_t pinReadFast(pin_t pin);
+int32_t analogRead(pin_t pin);
+
+bool attachInterrupt(uint16_t pin, void (*handler)(void), InterruptMode mode, int8_t priority = -1, uint8_t subpriority = 0);
+bool detachInterrupt(uint16_t pin);
+bool simAttachInterrupt(uint16_t pin, std::function<void()> handler, InterruptMode mode);
+
+template<typename T>
+bool attachInterrupt(uint16_t pin, void (T::*handler)(), T *instance, InterruptMode mode, int8_t priority = -1, uint8_t subpriority = 0) {
+  return simAttachInterrupt(pin, [=]() { (instance->*handler)(); }, mode);
+}
+
+// Software timers. On the device they run on their own thread; here they run from the clock.
+
+class Timer
+{
+public:
+  typedef void (*timer_callback_fn)(void);
+
+  Timer(unsigned period, timer_callback_fn callback, bool oneShot = false);
+
+  template<typename T>
+  Timer(unsigned period, void (T::*handler)(), T &instance, bool oneShot = false) :
+    Timer(period, std::function<void()>([handler, &instance]() { (instance.*handler)(); }), oneShot)
+  {
+  }
+
+  ~Timer();
+
+  bool start(unsigned block = 0);
+  bool stop(unsigned block = 0);
+  bool reset(unsigned block = 0);
+  bool changePeriod(unsigned period, unsigned block = 0);
+  bool isActive() const;
+
+  // Called by the clock. Runs the callback if it is due at 'nowUs'.
+  void fire(uint64_t nowUs);
+  uint64_t due() const;
+
+private:
+  Timer(unsigned period, std::function<void()> callback, bool oneShot);
+
+  std::function<void()> callback;
+  unsigned period;
+  bool oneShot;
+  bool active;
+  uint64_t nextUs;
+};
+
+// Text output
+
+class Print
+{
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+
+  size_t print(const char *str) { return write(str); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int value, int base = 10) { return print((long)value, base); }
+  size_t print(unsigned int value, int base = 10) { return print((unsigned long)value, base); }
+  size_t print(long value, int base = 10);
+  size_t print(unsigned long value, int base = 10);
+  size_t print(double value, int digits = 2);
+
+  size_t println() { return write("\r\n"); }
+  template<typename T>
+  size_t println(T value) { size_t n = print(value); return n + println(); }
+  template<typename T>
+  size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+  size_t printlnf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+  size_t vprintf(bool newline, const char *format, va_list args);
+};
+
+class String
+{
+public:
+  String() {}
+  String(const char *str) : value(str ? str : "") {}
+  String(int value) : value(std::to_string(value)) {}
+
+  const char *c_str() const { return value.c_str(); }
+  unsigned int length() const { return value.length(); }
+  bool operator==(const char *str) const { return value == str; }
+  bool operator!=(const char *str) const { return value != str; }
+
+private:
+  std::string value;
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+};
+
+// Serial output is collected for the simulation to look at; input comes from simSerialInput()
+class USBSerial : public Stream
+{
+public:
+  void begin(long baud) {}
+  bool isConnected() { return true; }
+
+  size_t write(uint8_t c) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int availableForWrite();
+};
+
+extern USBSerial Serial;
+
+// I2C. Every transaction is counted, and takes as long on the virtual clock as it would at 100 kHz.
+
+class TwoWire
+{
+public:
+  void begin() {}
+  bool isEnabled() { return true; }
+  void setSpeed(uint32_t speed) {}
+
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  size_t write(const uint8_t *data, size_t length);
+  uint8_t endTransmission(bool stop = true);
+};
+
+extern TwoWire Wire;
+
+// SPI. Every transfer is kept for the simulation to decode. One with a completion callback is
+// DMA and returns at once; one without takes as long on the virtual clock as the bits do.
+
+typedef void (*wiring_spi_dma_transfercomplete_callback_t)(void);
+enum { SPI_MODE0, SPI_MODE1, SPI_MODE2, SPI_MODE3 };
+enum { LSBFIRST, MSBFIRST };
+
+class SPIClass
+{
+public:
+  void begin() {}
+  void setBitOrder(uint8_t order) {}
+  void setDataMode(uint8_t mode) {}
+  unsigned setClockSpeed(unsigned value, unsigned scale = 1);
+  void transfer(const void *tx, void *rx, size_t length, wiring_spi_dma_transfercomplete_callback_t done);
+
+private:
+  unsigned clockHz = 0;
+};
+
+extern SPIClass SPI;
+extern SPIClass SPI1;
+
+// Cloud
+
+// Bits, so they combine the way Device OS's PublishFlags do: PRIVATE | NO_ACK
+enum PublishFlag { PUBLIC = 0x00, PRIVATE = 0x01, NO_ACK = 0x02, WITH_ACK = 0x08 };
+
+inline PublishFlag operator|(PublishFlag a, PublishFlag b) {
+  return (PublishFlag)((int)a | (int)b);
+}
+
+namespace particle {
+
+template <typename T>
+class Future;
+
+// What publish() hands back: done once the virtual clock reaches the end of the send. Reading
+// it as a bool waits for that, which the host counts like a delay().
+template <>
+class Future<bool>
+{
+public:
+  Future() : doneAtUs(0), ok(false) {}
+  Future(uint64_t doneAtUs, bool ok) : doneAtUs(doneAtUs), ok(ok) {}
+
+  bool isDone() const;
+  bool isSucceeded() const { return isDone() && ok; }
+  bool isFailed() const { return isDone() && !ok; }
+  bool wait() const;
+  operator bool() const { return wait(); }
+
+private:
+  uint64_t doneAtUs;
+  bool ok;
+};
+
+} // namespace particle
+
+class CloudClass
+{
+public:
+  bool variable(const char *name, const int &value);
+  bool variable(const char *name, const double &value);
+  bool variable(const char *name, const char *value);
+  bool function(const char *name, int (*handler)(String));
+
+  particle::Future<bool> publish(const char *name, const char *data, PublishFlag flags = PUBLIC,
+                                 PublishFlag more = PUBLIC);
+  bool connected();
+  bool process() { return true; }
+};
+
+extern CloudClass Particle;
+
+// Persistent storage
+
+#define SIM_EEPROM_SIZE 2047
+
+class EEPROMClass
+{
+public:
+  uint8_t read(int address) const;
+  void write(int address, uint8_t value);
+  size_t length() const { return SIM_EEPROM_SIZE; }
+
+  template<typename T>
+  T &get(int address, T &value) const {
+    for (size_t i = 0; i < sizeof(T); i++) {
+      ((uint8_t *)&value)[i] = read(address + i);
+    }
+    return value;
+  }
+
+  template<typename T>
+  const T &put(int address, const T &value) {
+    for (size_t i = 0; i < sizeof(T); i++) {
+      write(address + i, ((const uint8_t *)&value)[i]);
+    }
+    return value;
+  }
+};
+
+extern EEPROMClass EEPROM;
+
+// System and time
+
+enum HAL_Feature { FEATURE_RETAINED_MEMORY };
+
+class SystemClass
+{
+public:
+  static uint32_t ticks();
+  static uint32_t ticksPerMicrosecond() { return 120; }
+  static int enableFeature(HAL_Feature feature) { return 0; }
+};
+
+extern SystemClass System;
+
+class TimeClass
+{
+public:
+  static uint32_t now();
+  static bool isValid();
+};
+
+extern TimeClass Time;
+
+#endif // SIM_PARTICLE_H
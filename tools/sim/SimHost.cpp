@@ -0,0 +1,564 @@
+// Host implementation of tools/sim/Particle.h, driven through SimHost.h
+
+#include "SimHost.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+
+USBSerial Serial;
+TwoWire Wire;
+SPIClass SPI;
+SPIClass SPI1;
+CloudClass Particle;
+EEPROMClass EEPROM;
+SystemClass System;
+TimeClass Time;
+
+static uint64_t clockUs = 0;
+static uint32_t clockReads = 0;
+static SimStats stats;
+
+static int32_t analogLevels[SIM_PIN_COUNT];
+static SimAnalogSource analogSource = NULL;
+static uint8_t pinLevels[SIM_PIN_COUNT];
+
+struct SimInterrupt
+{
+  std::function<void()> handler;
+  InterruptMode mode;
+};
+static SimInterrupt interrupts[SIM_PIN_COUNT];
+
+static std::deque<char> serialIn;
+static std::string serialOut;
+
+static uint8_t wireAddress = 0;
+static std::vector<uint8_t> wireData;
+
+static std::vector<SimSpiTransfer> spiTransfers;
+
+// What an HD44780 behind the Grove controller would show: 2 rows of 40 cells of DDRAM
+static std::string lcdCells[2] = { std::string(40, ' '), std::string(40, ' ') };
+static uint8_t lcdAddress = 0;
+
+static bool cloudConnected = true;
+static bool publishResult = true;
+static std::vector<SimPublish> publishes;
+static std::map<std::string, std::function<std::string()>> variables;
+static std::map<std::string, int (*)(String)> functions;
+
+static uint8_t eeprom[SIM_EEPROM_SIZE];
+static bool eepromErased = false;
+
+static uint32_t unixTimeBase = 0;
+static uint64_t unixTimeSetUs = 0;
+
+// Constructed on first use, since the firmware's Timers are globals too
+static std::vector<Timer *> &timers() {
+  static std::vector<Timer *> list;
+  return list;
+}
+
+// Clock
+
+static uint64_t readClock() {
+  if (++clockReads > SIM_SPIN_LIMIT) {
+    fprintf(stderr, "sim: %u clock reads in one pass at %llu us, the firmware is spinning on the clock\n",
+            (unsigned)clockReads, (unsigned long long)clockUs);
+    abort();
+  }
+  return clockUs;
+}
+
+uint64_t simMicros() {
+  return clockUs;
+}
+
+void simAdvance(uint64_t us) {
+  uint64_t target = clockUs + us;
+  for (;;) {
+    Timer *next = NULL;
+    for (Timer *timer : timers()) {
+      if (timer->isActive() && timer->due() <= target && (!next || timer->due() < next->due())) {
+        next = timer;
+      }
+    }
+    if (!next) {
+      break;
+    }
+    clockUs = std::max(clockUs, next->due());
+    next->fire(clockUs);
+  }
+  clockUs = target;
+}
+
+void simBeginPass() {
+  clockReads = 0;
+}
+
+const SimStats &simStats() {
+  return stats;
+}
+
+void simResetStats() {
+  memset(&stats, 0, sizeof(stats));
+}
+
+unsigned long millis() {
+  return (unsigned long)(readClock() / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)readClock();
+}
+
+void delay(unsigned long ms) {
+  stats.delayCalls++;
+  stats.delayUs += (uint64_t)ms * 1000;
+  simAdvance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  stats.delayCalls++;
+  stats.delayUs += us;
+  simAdvance(us);
+}
+
+// Pins
+
+void pinMode(pin_t pin, PinMode mode) {
+}
+
+void digitalWrite(pin_t pin, uint8_t value) {
+  if (pin < SIM_PIN_COUNT) {
+    pinLevels[pin] = value ? HIGH : LOW;
+  }
+}
+
+int32_t digitalRead(pin_t pin) {
+  return pin < SIM_PIN_COUNT ? pinLevels[pin] : LOW;
+}
+
+int32_t pinReadFast(pin_t pin) {
+  return digitalRead(pin);
+}
+
+int32_t analogRead(pin_t pin) {
+  if (analogSource) {
+    return analogSource(pin, clockUs);
+  }
+  return pin < SIM_PIN_COUNT ? analogLevels[pin] : 0;
+}
+
+void simSetAnalog(pin_t pin, int32_t value) {
+  if (pin < SIM_PIN_COUNT) {
+    analogLevels[pin] = value;
+  }
+}
+
+void simSetAnalogSource(SimAnalogSource source) {
+  analogSource = source;
+}
+
+bool simAttachInterrupt(uint16_t pin, std::function<void()> handler, InterruptMode mode) {
+  if (pin >= SIM_PIN_COUNT) {
+    return false;
+  }
+  interrupts[pin].handler = handler;
+  interrupts[pin].mode = mode;
+  return true;
+}
+
+bool attachInterrupt(uint16_t pin, void (*handler)(void), InterruptMode mode, int8_t priority, uint8_t subpriority) {
+  return simAttachInterrupt(pin, handler, mode);
+}
+
+bool detachInterrupt(uint16_t pin) {
+  if (pin >= SIM_PIN_COUNT) {
+    return false;
+  }
+  interrupts[pin].handler = nullptr;
+  return true;
+}
+
+void simSetPin(pin_t pin, uint8_t level) {
+  if (pin >= SIM_PIN_COUNT || pinLevels[pin] == level) {
+    return;
+  }
+  pinLevels[pin] = level;
+
+  const SimInterrupt &interrupt = interrupts[pin];
+  if (interrupt.handler && (interrupt.mode == CHANGE || (interrupt.mode == RISING) == (level == HIGH))) {
+    stats.interrupts++;
+    interrupt.handler();
+  }
+}
+
+uint8_t simPinLevel(pin_t pin) {
+  return pin < SIM_PIN_COUNT ? pinLevels[pin] : LOW;
+}
+
+// Timers
+
+Timer::Timer(unsigned period, timer_callback_fn callback, bool oneShot) :
+  Timer(period, std::function<void()>(callback), oneShot)
+{
+}
+
+Timer::Timer(unsigned period, std::function<void()> callback, bool oneShot) :
+  callback(callback), period(period), oneShot(oneShot), active(false), nextUs(0)
+{
+  timers().push_back(this);
+}
+
+Timer::~Timer() {
+  std::vector<Timer *> &list = timers();
+  list.erase(std::remove(list.begin(), list.end(), this), list.end());
+}
+
+bool Timer::start(unsigned block) {
+  active = true;
+  nextUs = clockUs + (uint64_t)period * 1000;
+  return true;
+}
+
+bool Timer::stop(unsigned block) {
+  active = false;
+  return true;
+}
+
+bool Timer::reset(unsigned block) {
+  return start(block);
+}
+
+bool Timer::changePeriod(unsigned newPeriod, unsigned block) {
+  period = newPeriod;
+  return start(block);
+}
+
+bool Timer::isActive() const {
+  return active;
+}
+
+uint64_t Timer::due() const {
+  return nextUs;
+}
+
+void Timer::fire(uint64_t nowUs) {
+  if (!active || nowUs < nextUs) {
+    return;
+  }
+  // Periods are kept to the schedule, like the device's timer service
+  nextUs += (uint64_t)period * 1000;
+  if (oneShot) {
+    active = false;
+  }
+  stats.timerCallbacks++;
+  callback();
+}
+
+// Print
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::print(long value, int base) {
+  if (value < 0 && base == 10) {
+    return print('-') + print((unsigned long)-value, base);
+  }
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+  char buffer[8 * sizeof(long) + 1];
+  char *p = &buffer[sizeof(buffer) - 1];
+  *p = '\0';
+  if (base < 2) {
+    base = 10;
+  }
+  do {
+    unsigned digit = value % base;
+    *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    value /= base;
+  } while (value);
+  return write(p);
+}
+
+size_t Print::print(double value, int digits) {
+  char buffer[48];
+  snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+  return write(buffer);
+}
+
+size_t Print::vprintf(bool newline, const char *format, va_list args) {
+  char buffer[256];
+  int length = vsnprintf(buffer, sizeof(buffer), format, args);
+  size_t n = write(buffer);
+  if (newline) {
+    n += println();
+  }
+  return length < 0 ? 0 : n;
+}
+
+size_t Print::printf(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  size_t n = vprintf(false, format, args);
+  va_end(args);
+  return n;
+}
+
+size_t Print::printlnf(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  size_t n = vprintf(true, format, args);
+  va_end(args);
+  return n;
+}
+
+// Serial
+
+size_t USBSerial::write(uint8_t c) {
+  serialOut.push_back((char)c);
+  return 1;
+}
+
+int USBSerial::available() {
+  return (int)serialIn.size();
+}
+
+int USBSerial::read() {
+  if (serialIn.empty()) {
+    return -1;
+  }
+  char c = serialIn.front();
+  serialIn.pop_front();
+  return (uint8_t)c;
+}
+
+int USBSerial::availableForWrite() {
+  return 128;
+}
+
+void simSerialInput(const char *text) {
+  serialIn.insert(serialIn.end(), text, text + strlen(text));
+}
+
+std::string simTakeSerialOutput() {
+  std::string out;
+  out.swap(serialOut);
+  return out;
+}
+
+// Wire
+
+static void lcdCommand(uint8_t command) {
+  if (command == 0x01) {
+    lcdCells[0].assign(40, ' ');
+    lcdCells[1].assign(40, ' ');
+    lcdAddress = 0;
+  } else if (command == 0x02) {
+    lcdAddress = 0;
+  } else if (command & 0x80) {
+    lcdAddress = command & 0x7F;
+  }
+}
+
+static void lcdData(uint8_t data) {
+  uint8_t row = lcdAddress >= 0x40 ? 1 : 0;
+  uint8_t col = lcdAddress & 0x3F;
+  if (col < 40) {
+    lcdCells[row][col] = (char)data;
+  }
+  lcdAddress = (uint8_t)((row ? 0x40 : 0) + (col + 1) % 40);
+}
+
+// The first byte says whether the rest are commands (0x80) or characters (0x40)
+static void lcdTransaction(const std::vector<uint8_t> &data) {
+  if (data.empty()) {
+    return;
+  }
+  for (size_t i = 1; i < data.size(); i++) {
+    if (data[0] & 0x40) {
+      lcdData(data[i]);
+    } else {
+      lcdCommand(data[i]);
+    }
+  }
+}
+
+std::string simLcdLine(uint8_t row, uint8_t cols) {
+  return lcdCells[row & 1].substr(0, cols);
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  wireAddress = address & 0x7F;
+  wireData.clear();
+}
+
+size_t TwoWire::write(uint8_t data) {
+  wireData.push_back(data);
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t length) {
+  wireData.insert(wireData.end(), data, data + length);
+  return length;
+}
+
+uint8_t TwoWire::endTransmission(bool stop) {
+  uint32_t length = wireData.size() + 1;
+  stats.i2cTransactions++;
+  stats.i2cBytes += length;
+  stats.i2cBytesTo[wireAddress] += length;
+  stats.i2cUs += (uint64_t)length * SIM_I2C_BYTE_US;
+  if (wireAddress == SIM_LCD_ADDRESS) {
+    lcdTransaction(wireData);
+  }
+  simAdvance((uint64_t)length * SIM_I2C_BYTE_US);
+  return 0;
+}
+
+// SPI
+
+unsigned SPIClass::setClockSpeed(unsigned value, unsigned scale) {
+  clockHz = value * scale;
+  return clockHz;
+}
+
+void SPIClass::transfer(const void *tx, void *rx, size_t length, wiring_spi_dma_transfercomplete_callback_t done) {
+  const uint8_t *data = (const uint8_t *)tx;
+  spiTransfers.push_back({ clockUs, clockHz, done != NULL, std::vector<uint8_t>(data, data + length) });
+  if (done) {
+    done();
+  } else if (clockHz) {
+    simAdvance((uint64_t)length * 8 * 1000000 / clockHz);
+  }
+}
+
+const std::vector<SimSpiTransfer> &simSpiTransfers() {
+  return spiTransfers;
+}
+
+void simClearSpiTransfers() {
+  spiTransfers.clear();
+}
+
+// Cloud
+
+bool CloudClass::variable(const char *name, const int &value) {
+  const int *p = &value;
+  variables[name] = [p]() { return std::to_string(*p); };
+  return true;
+}
+
+bool CloudClass::variable(const char *name, const double &value) {
+  const double *p = &value;
+  variables[name] = [p]() { return std::to_string(*p); };
+  return true;
+}
+
+bool CloudClass::variable(const char *name, const char *value) {
+  variables[name] = [value]() { return std::string(value); };
+  return true;
+}
+
+bool CloudClass::function(const char *name, int (*handler)(String)) {
+  functions[name] = handler;
+  return true;
+}
+
+particle::Future<bool> CloudClass::publish(const char *name, const char *data, PublishFlag flags, PublishFlag more) {
+  if (!cloudConnected) {
+    return particle::Future<bool>(clockUs, false);
+  }
+  bool noAck = (flags | more) & NO_ACK;
+  publishes.push_back({ clockUs, name, data ? data : "", noAck, publishResult });
+  return particle::Future<bool>(clockUs + (noAck ? SIM_PUBLISH_SEND_US : SIM_PUBLISH_ACK_US), publishResult);
+}
+
+bool particle::Future<bool>::isDone() const {
+  return clockUs >= doneAtUs;
+}
+
+bool particle::Future<bool>::wait() const {
+  if (clockUs < doneAtUs) {
+    stats.delayCalls++;
+    stats.delayUs += doneAtUs - clockUs;
+    simAdvance(doneAtUs - clockUs);
+  }
+  return ok;
+}
+
+bool CloudClass::connected() {
+  return cloudConnected;
+}
+
+void simSetConnected(bool connected) {
+  cloudConnected = connected;
+}
+
+void simSetPublishResult(bool result) {
+  publishResult = result;
+}
+
+const std::vector<SimPublish> &simPublishes() {
+  return publishes;
+}
+
+void simClearPublishes() {
+  publishes.clear();
+}
+
+int simCallFunction(const char *name, const char *argument) {
+  auto it = functions.find(name);
+  return it == functions.end() ? -1 : it->second(String(argument));
+}
+
+std::string simVariable(const char *name) {
+  auto it = variables.find(name);
+  return it == variables.end() ? std::string() : it->second();
+}
+
+// EEPROM starts out erased, like a new device
+
+uint8_t EEPROMClass::read(int address) const {
+  if (!eepromErased) {
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    eepromErased = true;
+  }
+  return address >= 0 && address < SIM_EEPROM_SIZE ? eeprom[address] : 0xFF;
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+  read(address);
+  if (address >= 0 && address < SIM_EEPROM_SIZE) {
+    eeprom[address] = value;
+    stats.eepromWrites++;
+  }
+}
+
+// System and time
+
+uint32_t SystemClass::ticks() {
+  return (uint32_t)(readClock() * 120);
+}
+
+uint32_t TimeClass::now() {
+  return unixTimeBase + (uint32_t)((clockUs - unixTimeSetUs) / 1000000);
+}
+
+bool TimeClass::isValid() {
+  return unixTimeBase != 0;
+}
+
+void simSetTime(uint32_t unixTime) {
+  unixTimeBase = unixTime;
+  unixTimeSetUs = clockUs;
+}
@@ -0,0 +1,96 @@
+// Controls for the host simulation behind tools/sim/Particle.h: the virtual clock, the
+// scripted inputs, and counters for everything the firmware did to the outside world.
+
+#ifndef SIM_HOST_H
+#define SIM_HOST_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Particle.h"
+
+// clock reads in one loop() pass before the simulation calls it a spin on micros()
+#define SIM_SPIN_LIMIT 100000
+
+#define SIM_I2C_BYTE_US 90      // 9 bit times at 100 kHz
+#define SIM_LCD_ADDRESS 0x3E    // Grove LCD text controller
+#define SIM_PUBLISH_SEND_US 20000   // Until a NO_ACK publish is out of the device
+#define SIM_PUBLISH_ACK_US 400000   // Until the cloud acknowledges one sent with an ACK
+
+struct SimPublish
+{
+  uint64_t timeUs;
+  std::string name;
+  std::string data;
+  bool noAck;
+  bool delivered;   // false if simSetPublishResult() had the cloud drop it
+};
+
+struct SimSpiTransfer
+{
+  uint64_t timeUs;
+  uint32_t clockHz;
+  bool dma;
+  std::vector<uint8_t> data;
+};
+
+struct SimStats
+{
+  uint32_t delayCalls;          // delay() and delayMicroseconds() calls, and waits on a publish
+  uint64_t delayUs;             // time they held the caller up
+  uint32_t i2cTransactions;
+  uint32_t i2cBytes;            // address byte included
+  uint64_t i2cUs;
+  uint32_t i2cBytesTo[128];     // by device address
+  uint32_t timerCallbacks;
+  uint32_t interrupts;
+  uint32_t eepromWrites;
+};
+
+// Current virtual time
+uint64_t simMicros();
+
+// Move the clock forward, running timers and delivering interrupts as they come due
+void simAdvance(uint64_t us);
+
+// Everything the host has counted since the last reset
+const SimStats &simStats();
+void simResetStats();
+
+// Mark the start of a loop() pass, for the spin check
+void simBeginPass();
+
+// Analog inputs: a fixed level, or a function of time
+typedef int32_t (*SimAnalogSource)(pin_t pin, uint64_t nowUs);
+void simSetAnalog(pin_t pin, int32_t value);
+void simSetAnalogSource(SimAnalogSource source);
+
+// Drive an input pin, firing its interrupt if the edge matches
+void simSetPin(pin_t pin, uint8_t level);
+uint8_t simPinLevel(pin_t pin);
+
+// Text on the LCD, decoded from the I2C traffic to it
+std::string simLcdLine(uint8_t row, uint8_t cols = 16);
+
+// Every SPI transfer since the last clear, on SPI and SPI1 alike
+const std::vector<SimSpiTransfer> &simSpiTransfers();
+void simClearSpiTransfers();
+
+// Serial
+void simSerialInput(const char *text);
+std::string simTakeSerialOutput();
+
+// Cloud
+void simSetConnected(bool connected);
+// false makes every send go out and then fail, like one the cloud never took
+void simSetPublishResult(bool result);
+const std::vector<SimPublish> &simPublishes();
+void simClearPublishes();
+int simCallFunction(const char *name, const char *argument);
+std::string simVariable(const char *name);
+
+// Wall clock: Time.isValid() once set
+void simSetTime(uint32_t unixTime);
+
+#endif // SIM_HOST_H
@@ -0,0 +1,97 @@
+// Replays a sensor trace captured from the Serial port (see src/SensorTrace.h) through the
+// same BreathSession code the firmware runs, and checks the results against the ones the
+// device reported, and how long the readings would take with breath detection. Warm-ups go
+// through WarmupMonitor, to show where it would have called the sensor settled.
+//
+//   g++ -std=gnu++14 -O2 -Isrc -o trace-replay tools/trace-replay.cpp src/SensorTrace.cpp src/BreathSession.cpp src/BreathDetector.cpp src/ExponentialFit.cpp src/StreamingStats.cpp src/FixedPoint.cpp src/WarmupMonitor.cpp
+//   ./trace-replay capture.bin [speed]
+//
+// tools/breath-trace-gen.cpp writes synthetic traces to try it on.
+//
+// Without a speed the trace runs as fast as possible and the throughput is reported.
+// With one, records are paced by their timestamps (2 = twice real time).
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "SensorTrace.h"
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s trace.bin [speed]\n", argv[0]);
+    return 2;
+  }
+
+  FILE *file = fopen(argv[1], "rb");
+  if (file == NULL) {
+    perror(argv[1]);
+    return 2;
+  }
+  std::vector<uint8_t> data;
+  int c;
+  while ((c = fgetc(file)) != EOF) {
+    data.push_back(c);
+  }
+  fclose(file);
+
+  double speed = argc > 2 ? atof(argv[2]) : 0;
+
+  TraceDecoder decoder;
+  TraceReplay replay;
+  bool paced = false;
+  uint32_t firstTime = 0;
+  uint16_t breaths = 0;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < data.size(); i++) {
+    if (!decoder.push(data[i])) {
+      continue;
+    }
+
+    const TraceRecord &record = decoder.record();
+    if (speed > 0 && record.type != TRACE_HEADER) {
+      if (!paced) {
+        firstTime = record.time;
+        paced = true;
+      }
+      std::chrono::duration<double, std::milli> offset((record.time - firstTime) / speed);
+      std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offset));
+    }
+
+    uint16_t readings = replay.readings();
+    uint16_t warmups = replay.warmups();
+    replay.handle(record);
+    if (replay.warmups() != warmups) {
+      if (replay.lastSettledMs()) {
+        printf("warm-up %u: %u ms as recorded, settled after %u ms\n", replay.warmups(),
+               (unsigned)replay.lastWarmupMs(), (unsigned)replay.lastSettledMs());
+      } else {
+        printf("warm-up %u: %u ms as recorded, never settled\n", replay.warmups(), (unsigned)replay.lastWarmupMs());
+      }
+    }
+    if (replay.readings() != readings) {
+      const BreathResult &result = replay.lastResult();
+      breaths += result.breathDetected;
+      printf("reading %u: max %d PPM, avg %d +/- %.1f PPM, median %d PPM, max BAC %.5f, avg BAC %.5f%s\n",
+             replay.readings(), result.maxPPM, result.avgPPM, result.avgPPMConfidence, result.medianPPM, result.maxBAC,
+             result.avgBAC, result.breathDetected ? "" : " (no breath detected)");
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("%u samples, %u readings, %u matched, %u mismatched, %u bad frames\n",
+         replay.samples(), replay.readings(), replay.matches(), replay.mismatches(), decoder.badFrames());
+  if (replay.readings() > 0) {
+    printf("breath detected in %u of %u readings\n", breaths, replay.readings());
+    printf("mean reading time %.0f ms as recorded, %.0f ms with breath detection\n",
+           (double)replay.recordedReadingMs() / replay.readings(), (double)replay.detectedReadingMs() / replay.readings());
+  }
+  if (seconds > 0) {
+    printf("%.0f samples/s\n", replay.samples() / seconds);
+  }
+
+  return replay.mismatches() ? 1 : 0;
+}